@@ -0,0 +1,250 @@
+#ifndef BOARDWALK_H_
+#define BOARDWALK_H_
+
+#include <cinttypes>
+#include <climits>
+#include <string>
+#include <vector>
+
+#include "Boggle.h"
+
+#define Q_INDEX charToIndex('Q')
+#define U_INDEX charToIndex('U')
+#define QU_INDEX 26		// BoardWalk's letter code for a Q cell, which reads "QU"
+#define BLANK_INDEX -1	// BoardWalk's letter code for a blank cell
+#define cellBit(c) (1u << (c))
+
+using std::string;
+
+// neighbor cells of each cell, terminated by -1
+struct Neighbors {
+	int cells[BOARD_CELLS][9];
+
+	Neighbors();
+};
+
+extern const Neighbors neighbors;
+
+template <class Node>
+struct SearchFrame {
+	Node node;
+	int cell;
+	int next;	// position in the cell's neighbor list to try next
+	uint32_t blankLetters;	// letters still to try at the blank neighbor before 'next'
+	int length;		// letters in the word so far; a Q cell reads "QU"
+};
+
+// a Q cell is one step through the trie's Q and U edges
+template <class View>
+inline typename View::Node quChild(const View& view, typename View::Node node) {
+	typename View::Node child = view.child(node, Q_INDEX);
+	return child ? view.child(child, U_INDEX) : child;
+}
+
+/*
+ * Depth-first walk of every path on a board through a trie view, with an
+ * explicit stack so it can stop at each word and resume later. next() runs
+ * the walk to the next path that spells a word of at least MIN_WORD_LENGTH
+ * letters; a word reachable along several paths comes back once per path.
+ * Walks start from the cells in setOrder()'s order, board order by default.
+ * With a budget, next() also pauses after that many steps, a step being a
+ * move, a backtrack or a new start; done() tells the pause from the end.
+ * Until the next call, getPath() reads the word's cells off the stack.
+ */
+template <class View>
+class BoardWalk {
+	public:
+		typedef typename View::Node Node;
+
+		BoardWalk(const View& view, bool prefetch) : view(view), prefetch(prefetch), start(BOARD_CELLS),
+			startLetters(0), depth(0), visitedCells(0), budget(UINT_MAX) { }
+		void reset(const char* board);
+		void setOrder(const int* cells);
+		void setBudget(unsigned int steps) { budget = steps; }
+		bool next(FoundWord& word);
+		void getPath(uint32_t wordId, WordPath& path) const;
+		bool done() const { return start >= BOARD_CELLS; }
+
+	private:
+		View view;
+		bool prefetch;	// load the trie nodes the next moves will read ahead of use
+		int letters[BOARD_CELLS];	// letter index per cell, or QU_INDEX or BLANK_INDEX
+		int order[BOARD_CELLS];		// starting cells, in walk order
+		SearchFrame<Node> stack[BOARD_CELLS];	// a path visits each cell at most once
+		int start;		// position in order of the current walk's starting cell
+		uint32_t startLetters;	// letters the starting cell has yet to start a walk with
+		int depth;
+		uint32_t visitedCells;
+		unsigned int budget;	// steps left before next() pauses
+
+		uint32_t cellLetters(int cell) const;
+};
+
+template <class View>
+void BoardWalk<View>::reset(const char* board) {
+	for (int c = 0; c < BOARD_CELLS; c++) {
+		letters[c] = (board[c] == BLANK_CELL) ? BLANK_INDEX : (board[c] == 'Q') ? QU_INDEX : charToIndex(board[c]);
+		order[c] = c;
+	}
+	start = -1;
+	startLetters = 0;
+	depth = 0;
+}
+
+template <class View>
+void BoardWalk<View>::setOrder(const int* cells) {
+	// before the first next() only
+	for (int c = 0; c < BOARD_CELLS; c++) {
+		order[c] = cells[c];
+	}
+}
+
+template <class View>
+void BoardWalk<View>::getPath(uint32_t wordId, WordPath& path) const {
+	path = WordPath();
+	path.wordId = wordId;
+	path.length = depth;
+	for (int d = 0; d < depth; d++) {
+		path.setCell(d, stack[d].cell);
+	}
+}
+
+template <class View>
+uint32_t BoardWalk<View>::cellLetters(int cell) const {
+	// a blank starting cell starts one walk per letter under the root
+	if (letters[cell] == BLANK_INDEX) { return view.childMask(view.root()); }
+	if (letters[cell] == QU_INDEX) { return 1u << Q_INDEX; }
+	return 1u << letters[cell];
+}
+
+template <class View>
+bool BoardWalk<View>::next(FoundWord& word) {
+	while (true) {
+		if (budget == 0) { return false; }
+		budget--;
+
+		if (depth == 0) {
+			// start the next walk
+			if (startLetters == 0) {
+				if (++start >= BOARD_CELLS) { return false; }
+				startLetters = cellLetters(order[start]);
+				continue;
+			}
+			int index = __builtin_ctz(startLetters);
+			startLetters &= startLetters - 1;
+			Node node = (index == Q_INDEX) ? quChild(view, view.root()) : view.child(view.root(), index);
+			if (!node) { continue; }
+
+			visitedCells = cellBit(order[start]);
+			depth = 1;
+			stack[0].node = node;
+			stack[0].cell = order[start];
+			stack[0].next = 0;
+			stack[0].blankLetters = 0;
+			stack[0].length = (index == Q_INDEX) ? 2 : 1;
+		}
+
+		SearchFrame<Node>* frame = &stack[depth - 1];
+		const int* cells = neighbors.cells[frame->cell];
+		Node child = Node();
+		int cell = -1;
+		int step = 1;	// letters the move adds
+
+		while (true) {
+			if (frame->blankLetters != 0) {
+				// the blank neighbor just passed takes every letter the node has
+				int index = __builtin_ctz(frame->blankLetters);
+				cell = cells[frame->next - 1];
+				frame->blankLetters &= frame->blankLetters - 1;
+				step = (index == Q_INDEX) ? 2 : 1;
+				child = (index == Q_INDEX) ? quChild(view, frame->node) : view.child(frame->node, index);
+				if (child) { break; }
+				continue;
+			}
+			if ((cell = cells[frame->next]) < 0) { break; }
+			frame->next++;
+			if (visitedCells & cellBit(cell)) { continue; }
+			if ((unsigned int)letters[cell] >= 26) {
+				if (letters[cell] == QU_INDEX) {
+					step = 2;
+					child = quChild(view, frame->node);
+					if (child) { break; }
+				} else {
+					frame->blankLetters = view.childMask(frame->node);
+				}
+				continue;
+			}
+			step = 1;
+			child = view.child(frame->node, letters[cell]);
+			if (child) { break; }
+		}
+
+		if (cell < 0) {
+			// neighbors exhausted, backtrack
+			visitedCells &= ~cellBit(frame->cell);
+			depth--;
+			continue;
+		}
+
+		// push the child frame
+		int length = frame->length + step;
+		frame = &stack[depth++];
+		frame->node = child;
+		frame->cell = cell;
+		frame->next = 0;
+		frame->blankLetters = 0;
+		frame->length = length;
+		visitedCells |= cellBit(cell);
+
+		if (prefetch) {
+			// start loading the trie nodes the next candidate moves will read
+			cells = neighbors.cells[cell];
+			for (int m = 0; cells[m] >= 0; m++) {
+				if (!(visitedCells & cellBit(cells[m])) && ((unsigned int)letters[cells[m]] < 26)) {
+					view.prefetchChild(child, letters[cells[m]]);
+				}
+			}
+		}
+
+		if (view.isLeaf(child) && (length >= MIN_WORD_LENGTH)) {
+			word.wordId = view.wordId(child);
+			word.len = length;
+			return true;
+		}
+	}
+}
+
+/*
+ * Pull-based solve of a Boggle's current board: words come back one at a
+ * time, each once, in the order the walk finds them, and the caller pays
+ * only for the part of the search it asks for. Runs over the compact trie
+ * when the solver has one, else the pointer trie, else LOUDS. reset() after
+ * every new board.
+ */
+class WordIterator {
+	public:
+		explicit WordIterator(Boggle& boggle, bool prefetch = true);
+		~WordIterator();
+		void reset();
+		bool next(uint32_t& wordId, int& len);
+		bool next(string& word);
+		size_t getWordCount() const { return yielded.size(); }
+		int getPoints() const { return points; }
+
+	private:
+		Boggle& boggle;
+		bool prefetch;
+		BoardWalk<CompactTrieView>* compactWalk;
+		BoardWalk<PointerTrieView>* pointerWalk;
+		BoardWalk<LoudsTrieView>* loudsWalk;
+		std::vector<uint64_t> seen;		// bit per word ID yielded since reset
+		std::vector<uint32_t> yielded;
+		int points;
+
+		WordIterator(WordIterator const&);
+		WordIterator& operator=(WordIterator const&);
+
+		void clearWalks();
+};
+
+#endif	// BOARDWALK_H_
@@ -1,37 +1,252 @@
 #ifndef BOGGLE_H_
 #define BOGGLE_H_
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
-#include <list>
+#include <random>
 #include <string>
+#include <vector>
 
+#include "CompactTrie.h"
+#include "Completer.h"
+#include "DiceSet.h"
+#include "DictJournal.h"
 #include "Logger.h"
+#include "LoudsTrie.h"
+#include "Pattern.h"
 #include "Trie.h"
 
+#define BOARD_SIZE 5
+#define BOARD_CELLS (BOARD_SIZE * BOARD_SIZE)
+#define MIN_WORD_LENGTH 4
+#define WORD_COUNTS 24
+#define BLANK_CELL '?'	// blank die face, stands for any letter
+#define SOLVE_CHECK_STEPS 256	// walk steps between deadline and cancel checks, ~10 us
+#define PATH_BITS 5		// bits per cell index in a WordPath
+
+// dictionary layouts a Boggle keeps in memory
+#define LAYOUT_POINTER 0x1
+#define LAYOUT_COMPACT 0x2
+#define LAYOUT_LOUDS 0x4
+#define LAYOUT_DEFAULT (LAYOUT_POINTER | LAYOUT_COMPACT)
+
+enum SolveEngine {
+	ENGINE_AUTO,	// pick an engine per board with the cost model
+	ENGINE_BOARD,	// DFS from every cell, following trie children
+	ENGINE_DICT,	// walk the dictionary, checking each word against the board
+	ENGINE_ITERATIVE,	// ENGINE_BOARD with an explicit stack and child prefetch
+	ENGINE_COMPACT,		// ENGINE_ITERATIVE over the compact trie layout
+	ENGINE_LOUDS		// ENGINE_ITERATIVE over the succinct LOUDS layout
+};
+
+enum PathMode {
+	PATHS_NONE,
+	PATHS_FIRST,	// one path per word, the first the walk finds
+	PATHS_ALL		// every path that spells a word
+};
+
+/*
+ * The board cells a word is spelled along, read off the walk's stack when
+ * it reaches the word: PATH_BITS per cell index, the first cell in the low
+ * bits of cells[0], running on into cells[1].
+ */
+struct WordPath {
+	uint32_t wordId;
+	uint32_t length;	// cells on the path
+	uint64_t cells[2];
+
+	WordPath() : wordId(0), length(0), cells() { }
+	int getCell(int step) const {
+		int bit = step * PATH_BITS;
+		uint64_t bits = cells[bit / 64] >> (bit % 64);
+		if (bit % 64 > 64 - PATH_BITS) { bits |= cells[bit / 64 + 1] << (64 - bit % 64); }
+		return bits & ((1u << PATH_BITS) - 1);
+	}
+	void setCell(int step, int cell) {
+		int bit = step * PATH_BITS;
+		cells[bit / 64] |= (uint64_t)cell << (bit % 64);
+		if (bit % 64 > 64 - PATH_BITS) { cells[bit / 64 + 1] |= (uint64_t)cell >> (64 - bit % 64); }
+	}
+	bool operator<(const WordPath& path) const { return wordId < path.wordId; }
+	bool operator==(const WordPath& path) const { return wordId == path.wordId; }
+};
+
+struct SolveOptions {
+	SolveEngine engine;
+	bool listWords;		// resolve word IDs to strings; scores and IDs only when false
+	bool prefetch;		// ENGINE_ITERATIVE prefetches trie child nodes ahead of use
+	// Overlay dictionaries whose words count, DICTS_ALL for all of them. A
+	// selection that leaves one out runs ENGINE_ITERATIVE over the pointer trie.
+	uint8_t dictionaries;
+	// Paths other than PATHS_NONE run on the walk engines, which capture each
+	// path from their stack as they reach the word.
+	PathMode paths;
+	// Bounded solves stop at the deadline, or once *cancel is set, and return
+	// the words found so far. They run on the walk engines, starting from the
+	// cells with the most dictionary below them.
+	std::chrono::steady_clock::time_point deadline;
+	const std::atomic<bool>* cancel;
+
+	SolveOptions() : engine(ENGINE_AUTO), listWords(true), prefetch(true), dictionaries(DICTS_ALL),
+		paths(PATHS_NONE), deadline(std::chrono::steady_clock::time_point::max()), cancel(NULL) { }
+	bool bounded() const { return (cancel != NULL) || (deadline != std::chrono::steady_clock::time_point::max()); }
+};
+
+struct SolveResult {
+	std::vector<uint32_t> wordIds;	// sorted, unique; same order as the words
+	std::vector<string> words;		// empty unless SolveOptions::listWords
+	// grouped by word ID, in wordIds order; with PATHS_FIRST paths[i] spells
+	// wordIds[i]; empty unless SolveOptions::paths
+	std::vector<WordPath> paths;
+	int points;
+	int wordCounts[WORD_COUNTS];	// index is word length - MIN_WORD_LENGTH
+	SolveEngine engine;			// engine that produced the result
+	bool complete;		// false when a deadline or cancel stopped the search
+
+	SolveResult() : points(0), wordCounts(), engine(ENGINE_AUTO), complete(true) { }
+};
+
+// process-wide solve counters
+struct SolveMetrics {
+	uint64_t solves;
+	uint64_t bounded;		// solves with a deadline or cancel token
+	uint64_t timeouts;		// bounded solves stopped by their deadline
+	uint64_t cancels;		// bounded solves stopped by their cancel token
+
+	SolveMetrics() : solves(0), bounded(0), timeouts(0), cancels(0) { }
+};
+
+struct PlayerScore {
+	int points;		// from unique words only
+	int words;		// distinct submitted words that are on the board
+	int unique;		// of those, words no other player submitted
+	int invalid;	// submissions not in the dictionary, not on the board or too short
+
+	PlayerScore() : points(0), words(0), unique(0), invalid(0) { }
+};
+
+struct FoundWord {
+	uint32_t wordId;
+	int len;
+
+	bool operator<(const FoundWord& word) const { return wordId < word.wordId; }
+	bool operator==(const FoundWord& word) const { return wordId == word.wordId; }
+};
+
+// streamed pattern match; return false to stop the search
+typedef std::function<bool(const string& word, uint32_t wordId)> PatternCallback;
+
+class ResultWriter;
+class WordIterator;
+
 class Boggle {
 	public:
-		Boggle();
+		explicit Boggle(int layouts = LAYOUT_DEFAULT);
+		Boggle(const char* dictFileName, const char* trieFileName, int layouts = LAYOUT_DEFAULT);
+		explicit Boggle(Boggle* dictionarySource);
+		// maps a compact trie file from saveCompact() read-only, so processes
+		// share its pages; solves and word lookups only, no layouts on failure
+		explicit Boggle(const char* compactFileName);
+		// rolls 'dice'; the dictionary is filtered to words they can spell and
+		// kept in a trie file keyed to the dice set
+		Boggle(const DiceSet& dice, int layouts = LAYOUT_DEFAULT);
 		~Boggle();
 		void newGame();
+		void newGame(unsigned int seed);
+		bool setBoard(const char* letters);
+		void getBoard(char* letters);
 		void printBoard(std::ostream& stream);
 		void solveGame(std::ostream& stream);
-		TrieInfo getTrieInfo() { return dictionary.getTrieInfo(); }
+		void solveGame(ResultWriter& writer, SolveOptions options = SolveOptions());
+		void solve(SolveResult& result, SolveEngine engine = ENGINE_AUTO);
+		void solve(SolveResult& result, const SolveOptions& options);
+		SolveEngine selectEngine();
+		// points of every word a walk could spell if it could revisit cells but
+		// not use more of a letter than the board has: never below solve()'s
+		int scoreBound();
+		TrieInfo getTrieInfo();
+		// root hash of the words solved over, as Trie::getHash() has it; without
+		// the pointer trie it is recomputed over the nodes, O(nodes)
+		uint64_t getDictionaryHash();
+		bool saveCompact(const char* fileName) { return compact.save(fileName); }
+		bool getWord(uint32_t wordId, string& word);
+		bool getWordId(const string& word, uint32_t& wordId);
+		void scoreRound(const std::vector<std::vector<string> >& submissions, std::vector<PlayerScore>& scores);
+		int getLayouts() { return layouts; }
+		bool profileLayout(unsigned int boards, unsigned int seed);
+		// reads the source's compact or LOUDS layout in place; a pointer-only
+		// source gains the compact layout, so share before its threads start
+		void shareDictionary(Boggle* dictionarySource);
+		// dictionary edits, journaled beside the trie file; need LAYOUT_POINTER
+		// and no other solver sharing this dictionary. An edit is O(word); the
+		// first lookup or solve after a batch of edits renumbers the words and
+		// rebuilds the compact and LOUDS layouts, O(nodes): on the default
+		// dictionary about 40 ms, plus 100 ms for compact and 180 ms for LOUDS,
+		// so batch edits between solves
+		bool addWord(const string& word);
+		bool removeWord(const string& word);
+		bool compactJournal(bool wait = false);
+		// another word list in the same trie as dictionary 'index', saved to the
+		// trie file; needs LAYOUT_POINTER
+		bool loadOverlay(const char* dictFileName, int index);
+		bool filterDictionary(const DiceSet& dice);
+		// ranked completions of a prefix; needs LAYOUT_COMPACT
+		bool loadCompletions(CompletionRank rank, const char* weightFileName = NULL);
+		uint32_t complete(const string& prefix, size_t k, std::vector<string>& words);
+		bool matchPattern(const string& pattern, const PatternCallback& callback);
+		static int wordPoints(int len);
+		static SolveMetrics getMetrics();
 
 	private:
+		friend class WordIterator;
+
 		char board[5][5] = { {}, {}, {}, {}, {} };
 		string dice[25];
+		DiceSet diceSet;
 		Trie dictionary;
+		CompactTrie compact;
+		LoudsTrie louds;
+		DictJournal journal;
+		Completer completer;
+		CompletionRank completionRank;
+		string completionWeights;	// weight file for RANK_WEIGHT
+		bool dirty;		// dictionary edited since the layouts and word IDs were built
+		int layouts;
+		int blanks;		// BLANK_CELL cells on the board
+		string trieFile;
+		uint32_t prefixNodes[26][26];	// trie nodes below each two-letter prefix
 		bool visited[5][5] = { {}, {}, {}, {}, {} };
-		std::list<string> words;
+		std::vector<FoundWord> found;
+		std::vector<WordPath> foundPaths;	// walk order until solve() sorts them
+		std::mt19937 rng;
+
+		// per-board filters for the dictionary engine
+		int letterCounts[26];
+		bool bigrams[26][26];
 
 		void clearBoard();
 		void clearVisited();
-		void findWords();
 		bool isSafe(int i, int j);
 		void loadBoard();
 		void loadDice();
-		void loadDict();
+		void loadDict(const char* dictFileName, const char* trieFileName);
+		void loadLayouts();
+		void refreshLayouts();
+		void adjustPrefixNodes(const string& key, int before, int after);
+		void loadFilters();
+		void loadPrefixNodes();
+		bool matchPath(const char* word, int len, int i, int j);
+		void searchDict(TrieNode* node, char* word, int len);
+		template <class View> bool searchIterative(const View& view, const SolveOptions& options);
+		void loadStartOrder(int* cells);
+		template <class View> static uint64_t hashNodes(const View& view, typename View::Node node);
+		template <class View> static bool lookupWord(const View& view, const string& word, uint32_t& wordId);
+		template <class View> static bool searchPattern(const View& view, const Pattern& pattern,
+			typename View::Node node, uint64_t states, string& word, const PatternCallback& callback);
 		void searchWord(TrieNode* root, int i, int j, string str);
+		static int engineLayout(SolveEngine engine);
 };
 
 #endif	// BOGGLE_H_
@@ -0,0 +1,60 @@
+#ifndef BOGGLEAPI_H_
+#define BOGGLEAPI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BOGGLE_API_VERSION 1
+#define BOGGLE_BOARD_CELLS 25
+#define BOGGLE_ERROR_ARGUMENT (-1)	// boggle_solve() given a NULL handle or array
+#define BOGGLE_API __attribute__((visibility("default")))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * C interface for bindings, built as libboggle.so. A boggle_dict is one
+ * dictionary shared by every thread solving with it: each call borrows a
+ * solver from the handle's pool and hands it back, so calls may run
+ * concurrently, and once the pool has a solver per concurrent caller they
+ * allocate nothing. Nothing crosses the interface as a string.
+ *
+ * Boards are BOGGLE_BOARD_CELLS bytes each, row by row, 'A'-'Z' with 'Q'
+ * reading "QU" and '?' a blank, packed back to back without terminators.
+ * Word IDs number the dictionary's words in alphabetical order.
+ *
+ * The library never writes to the host's stdout or stderr; boggle_log()
+ * sends its log lines, errors included, to a file instead.
+ */
+typedef struct boggle_dict boggle_dict;
+
+// A word list and the trie file compiled from it, built on first use; or,
+// with wordFileName NULL, a compact trie file from --compile-trie, mapped
+// read-only so processes share its pages. NULL when nothing loads.
+BOGGLE_API boggle_dict* boggle_open(const char* wordFileName, const char* trieFileName);
+
+/*
+ * Solves 'count' boards. Board b's points go to scores[b], -1 for a board
+ * with a letter outside the alphabet above. Its word IDs, sorted, go to
+ * wordIds from offsets[b] up to offsets[b + 1]; offsets takes count + 1
+ * entries. Returns the boards solved: fewer than count when the next
+ * board's words don't fit in wordCapacity, so the caller can drain the
+ * arrays and go on from there, or BOGGLE_ERROR_ARGUMENT. wordIds and
+ * offsets may both be NULL for scores only.
+ */
+BOGGLE_API int64_t boggle_solve(boggle_dict* dict, const char* boards, size_t count, int32_t* scores,
+	uint32_t* wordIds, size_t wordCapacity, uint64_t* offsets);
+
+// no boggle_solve() may be running on the handle
+BOGGLE_API void boggle_close(boggle_dict* dict);
+
+// Appends log lines to the file, or with NULL stops logging; call it while
+// no other boggle_ function is running.
+BOGGLE_API void boggle_log(const char* logFileName);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// BOGGLEAPI_H_
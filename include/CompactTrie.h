@@ -0,0 +1,97 @@
+#ifndef COMPACTTRIE_H_
+#define COMPACTTRIE_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+#include "NodePool.h"
+#include "Trie.h"
+
+#define COMPACT_MAGIC 0x54434f42u	// "BOCT"
+#define COMPACT_LEAF (1u << 31)
+#define COMPACT_CHILDREN ((1u << 26) - 1)
+
+using std::string;
+
+/*
+ * Read-only trie in one flat array, in the same breadth-first order as the
+ * trie file. Bit i of 'mask' is set when letter i has a child; children are
+ * stored contiguously from 'firstChild' in letter order, so a child's index
+ * is firstChild plus the number of set bits below its letter. Index 0 is the
+ * root, which is never anyone's child, so 0 doubles as "no child".
+ */
+struct CompactTrieNode {
+	uint32_t mask;
+	uint32_t firstChild;
+	uint32_t wordId;
+};
+
+struct CompactTrieHeader {
+	uint32_t magic;
+	uint32_t nodeCount;
+	uint32_t wordCount;
+	uint32_t reserved;
+};
+
+class CompactTrie {
+	public:
+		CompactTrie();
+		~CompactTrie();
+		void clear();
+		bool build(Trie& trie);
+		bool attach(const void* data, size_t size);
+		bool attachEmbedded();
+		void share(const CompactTrie& trie);
+		bool load(const char* fileName);
+		bool map(const char* fileName);
+		bool save(const char* fileName);
+		bool getWord(uint32_t wordId, string& word) const;
+		const CompactTrieNode* getNodes() const { return nodes; }
+		uint32_t getNodeCount() const { return nodeCount; }
+		uint32_t getWordCount() const { return wordCount; }
+		size_t getSize() const { return nodeCount * sizeof(CompactTrieNode); }
+		bool isEmbedded() const { return embedded; }
+
+		static inline uint32_t child(const CompactTrieNode* node, int index) {
+			uint32_t bit = 1u << index;
+			if (!(node->mask & bit)) { return 0; }
+			return node->firstChild + __builtin_popcount(node->mask & (bit - 1));
+		}
+
+	private:
+		const CompactTrieNode* nodes;
+		uint32_t nodeCount;
+		uint32_t wordCount;
+		bool embedded;
+		CompactTrieNode* owned;
+		size_t ownedSize;
+		void* mapped;		// file mapping the nodes are read from, if any
+		size_t mappedSize;
+
+		CompactTrie(CompactTrie const&);
+		CompactTrie& operator=(CompactTrie const&);
+
+		bool allocate(uint32_t count);
+		bool validate() const;
+		uint32_t assignWordIds(uint32_t node, uint32_t nextId);
+};
+
+// static dictionary linked into EMBEDDED_DICT builds
+bool getEmbeddedDict(const void*& data, size_t& size);
+
+// solver access to the compact layout; see PointerTrieView
+struct CompactTrieView {
+	typedef uint32_t Node;
+	const CompactTrieNode* nodes;
+
+	explicit CompactTrieView(const CompactTrie& trie) : nodes(trie.getNodes()) { }
+	Node root() const { return 0; }
+	Node child(Node node, int index) const { return CompactTrie::child(&nodes[node], index); }
+	uint32_t childMask(Node node) const { return nodes[node].mask & COMPACT_CHILDREN; }
+	bool isLeaf(Node node) const { return nodes[node].mask & COMPACT_LEAF; }
+	uint32_t wordId(Node node) const { return nodes[node].wordId; }
+	void prefetchChild(Node node, int) const { __builtin_prefetch(&nodes[nodes[node].firstChild]); }
+};
+
+#endif	// COMPACTTRIE_H_
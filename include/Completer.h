@@ -0,0 +1,55 @@
+#ifndef COMPLETER_H_
+#define COMPLETER_H_
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+#include "CompactTrie.h"
+
+#define COMPLETION_CACHE_K 16		// completions cached per popular prefix
+#define COMPLETION_CACHE_WORDS 2048u	// subtree size that earns a node a cache
+
+using std::string;
+
+enum CompletionRank {
+	RANK_POINTS,	// word points, then length
+	RANK_LENGTH,	// longest words first
+	RANK_WEIGHT		// weights from a "WORD weight" file, 0 when not listed
+};
+
+struct Completion {
+	uint32_t wordId;
+	uint32_t weight;
+};
+
+/*
+ * Ranked prefix completion over a compact trie. Every node knows how many
+ * words its subtree holds and the best weight in it, so a query expands nodes
+ * best-first and stops after k words instead of walking the subtree. Ties go
+ * to the lower word ID, i.e. alphabetical order. Nodes with large subtrees
+ * also keep their top COMPLETION_CACHE_K completions precomputed.
+ */
+class Completer {
+	public:
+		Completer() : trie(NULL), rank(RANK_POINTS) { }
+		bool build(const CompactTrie& trie, CompletionRank rank, const char* weightFileName = NULL);
+		void clear();
+		bool isBuilt() const { return trie != NULL; }
+		uint32_t complete(const string& prefix, size_t k, std::vector<Completion>& completions) const;
+		size_t getSize() const;
+
+	private:
+		const CompactTrie* trie;
+		CompletionRank rank;
+		std::vector<uint32_t> weights;		// per node; meaningful on leaves
+		std::vector<uint32_t> bestWeights;	// per node, best leaf weight in the subtree
+		std::vector<uint32_t> subtreeWords;	// per node
+		std::vector<uint32_t> cacheIndex;	// per node, offset into cache + 1, or 0
+		std::vector<Completion> cache;
+
+		bool loadWeights(const char* weightFileName);
+		void search(uint32_t node, size_t k, std::vector<Completion>& completions) const;
+};
+
+#endif	// COMPLETER_H_
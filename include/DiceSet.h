@@ -0,0 +1,42 @@
+#ifndef DICESET_H_
+#define DICESET_H_
+
+#include <cinttypes>
+#include <string>
+
+#define DICE_COUNT 25		// one die per board cell
+#define DICE_FACES 6
+
+using std::string;
+
+enum DiceFit {
+	DICE_FIT,
+	DICE_TOO_LONG,		// more letters than there are dice
+	DICE_BARE_Q,		// a Q face always reads "Qu"
+	DICE_LETTERS		// no assignment of distinct dice spells it
+};
+
+/*
+ * The dice newGame rolls, and which words they can spell at all. Each die
+ * contributes one letter to a word; a Q face stands for "QU". A word fits
+ * when its letters can be matched to distinct dice carrying them, which is
+ * a bipartite matching of at most DICE_COUNT letters against the dice.
+ */
+class DiceSet {
+	public:
+		DiceSet();
+		bool load(const char* fileName);
+		const string& getDie(int die) const { return dice[die]; }
+		DiceFit fit(const string& word) const;
+		uint32_t getKey() const;
+		string keyedFileName(const string& fileName) const;
+
+	private:
+		string dice[DICE_COUNT];
+		uint32_t letterDice[26];	// bit d is set when die d has the letter
+
+		void loadLetterDice();
+		bool match(const int* letters, int position, uint32_t& tried, int* owners) const;
+};
+
+#endif	// DICESET_H_
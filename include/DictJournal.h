@@ -0,0 +1,56 @@
+#ifndef DICTJOURNAL_H_
+#define DICTJOURNAL_H_
+
+#include <cinttypes>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Trie.h"
+
+#define JOURNAL_SUFFIX ".journal"
+#define JOURNAL_COMPACT_RECORDS 4096u	// records that trigger a background compaction
+
+using std::string;
+
+/*
+ * Append-only log of dictionary edits kept beside the trie file, one text
+ * record per edit: "+WORD\n" for an insert, "-WORD\n" for an erase. Each
+ * record sets a word's membership outright, so replaying a prefix of the log
+ * twice is harmless and a torn final record (no newline) is ignored.
+ *
+ * Compaction replays the journal onto a fresh copy of the base trie on a
+ * background thread, writes it over the trie file, and keeps only the records
+ * appended while it ran.
+ */
+class DictJournal {
+	public:
+		DictJournal();
+		~DictJournal();
+		void open(const char* trieFileName);
+		void close();
+		bool append(bool insert, const string& word);
+		uint64_t replay(Trie& trie);
+		bool startCompaction();
+		bool waitCompaction();
+		uint64_t getRecordCount();
+
+	private:
+		string trieFileName;
+		string journalFileName;
+		std::mutex lock;
+		ofstream file;
+		uint64_t records;
+		std::thread compactor;
+		bool compacting;
+		bool compacted;
+
+		DictJournal(DictJournal const&);
+		DictJournal& operator=(DictJournal const&);
+
+		void compact();
+		static uint64_t replayFile(const string& fileName, Trie& trie, uint64_t& endOffset);
+};
+
+#endif	// DICTJOURNAL_H_
@@ -0,0 +1,97 @@
+#ifndef LIVEDICTIONARY_H_
+#define LIVEDICTIONARY_H_
+
+#include <atomic>
+#include <cinttypes>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Boggle.h"
+
+#define MAX_READERS 64
+#define CACHE_LINE 64
+
+using std::string;
+
+// one published dictionary; 'boggle' owns the compact trie readers share
+struct DictionarySnapshot {
+	Boggle* boggle;
+	uint64_t generation;
+	uint64_t retireEpoch;	// first epoch in which no reader can still see it
+};
+
+/*
+ * Dictionary that can be replaced while solves are running, with epoch-based
+ * reclamation. A reader announces the global epoch in its slot before it
+ * loads the current snapshot and clears the slot when done. A reload loads
+ * the new snapshot off to the side, publishes it, then advances the epoch;
+ * the old snapshot is freed once every slot is idle or has announced an
+ * epoch at least its retireEpoch. Readers with a slot never block or take a
+ * lock. Readers past MAX_READERS have none and hold overflowLock shared for
+ * their read section instead; reclaim frees nothing while one is inside.
+ */
+class LiveDictionary {
+	public:
+		LiveDictionary(const char* dictFileName, const char* trieFileName);
+		~LiveDictionary();
+		bool reload(const char* dictFileName, const char* trieFileName);
+		bool startReload(const char* dictFileName, const char* trieFileName);
+		bool waitReload();
+		bool reclaim();
+		uint64_t getGeneration() { return current.load()->generation; }
+
+		// reader side, see DictionaryReader
+		int registerReader();
+		void unregisterReader(int slot);
+		const DictionarySnapshot* enter(int slot);
+		void exit(int slot);
+
+	private:
+		struct alignas(CACHE_LINE) ReaderSlot {
+			std::atomic<uint64_t> epoch;	// 0 when outside a read section
+			std::atomic<bool> used;
+		};
+
+		ReaderSlot slots[MAX_READERS];
+		std::atomic<DictionarySnapshot*> current;
+		std::atomic<uint64_t> epoch;
+		std::mutex writerLock;
+		std::shared_mutex overflowLock;		// held shared by readers without a slot
+		std::vector<DictionarySnapshot*> retired;
+		std::thread reloader;
+		bool reloaded;
+
+		LiveDictionary(LiveDictionary const&);
+		LiveDictionary& operator=(LiveDictionary const&);
+
+		bool reclaimRetired();
+		static DictionarySnapshot* loadSnapshot(const char* dictFileName, const char* trieFileName, uint64_t generation);
+};
+
+/*
+ * Per-thread access to a LiveDictionary: begin() returns this thread's solver
+ * bound to the current snapshot, which stays valid until end(). A reader that
+ * found no free slot still works, on the locked path.
+ */
+class DictionaryReader {
+	public:
+		explicit DictionaryReader(LiveDictionary& live);
+		~DictionaryReader();
+		Boggle& begin();
+		void end() { live.exit(slot); }
+		bool isRegistered() { return slot >= 0; }
+
+	private:
+		LiveDictionary& live;
+		int slot;
+		Boggle* solver;
+		uint64_t generation;
+
+		DictionaryReader(DictionaryReader const&);
+		DictionaryReader& operator=(DictionaryReader const&);
+};
+
+#endif	// LIVEDICTIONARY_H_
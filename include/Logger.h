@@ -14,11 +14,16 @@ class Logger {
 		void openLogFile(const char* fileName, bool trunc = false);
 		void closeLogFile();
 		void log(const char* fmt, ...);
+		// where log lines are echoed, NULL for nowhere; stdout and stderr by default
+		void setConsole(FILE* info, FILE* error) { infoConsole = info; errorConsole = error; }
+		void echo(bool error, const char* fmt, ...);
 
 	private:
 		static Logger* instance;
 		FILE* logFile;
-		Logger() { logFile = NULL; };
+		FILE* infoConsole;
+		FILE* errorConsole;
+		Logger() { logFile = NULL; infoConsole = stdout; errorConsole = stderr; };
 		Logger(Logger const&) { };
 		Logger& operator=(Logger const&) { };
 };
@@ -43,7 +48,7 @@ class Logger {
 #define LOG_INFO_INDENT(indent, message, args...)										\
 	do {																				\
 		Logger::Instance()->log(LOG_FMT message NEWLINE, LOG_ARGS("INFO"), ## args);	\
-		fprintf(stdout, INDENT_FMT message NEWLINE, (indent * 4), "", ## args);			\
+		Logger::Instance()->echo(false, INDENT_FMT message NEWLINE, (indent * 4), "", ## args);	\
 	} while(0)
 
 #define LOG_INFO(message, args...) LOG_INFO_INDENT(0, message, ## args)
@@ -51,7 +56,7 @@ class Logger {
 #define LOG_ERROR_INDENT(indent, message, args...)										\
 	do {																				\
 		Logger::Instance()->log(LOG_FMT message NEWLINE, LOG_ARGS("ERROR"), ## args);	\
-		fprintf(stderr, INDENT_FMT message NEWLINE, (indent * 4), "", ## args);			\
+		Logger::Instance()->echo(true, INDENT_FMT message NEWLINE, (indent * 4), "", ## args);	\
 	} while(0)
 
 #define LOG_ERROR(message, args...) LOG_ERROR_INDENT(0, message, ## args)
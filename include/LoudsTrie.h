@@ -0,0 +1,138 @@
+#ifndef LOUDSTRIE_H_
+#define LOUDSTRIE_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using std::string;
+
+#define RANK_BLOCK 512		// bits per rank sample
+#define SELECT_SAMPLE 512	// ones (or zeros) per select sample
+
+/*
+ * Static bitvector with rank and select. Rank uses one cumulative count per
+ * RANK_BLOCK bits; select starts from a sampled block and scans forward.
+ */
+class BitVector {
+	public:
+		BitVector();
+		void push(bool bit);
+		void build();
+		void clear();
+		bool get(uint64_t pos) const { return (words[pos >> 6] >> (pos & 63)) & 1; }
+		uint64_t rank1(uint64_t pos) const;
+		uint64_t select0(uint64_t k) const;
+		uint64_t select1(uint64_t k) const;
+		uint64_t size() const { return bits; }
+		size_t getSize() const;
+
+	private:
+		std::vector<uint64_t> words;
+		std::vector<uint32_t> ranks;
+		std::vector<uint32_t> zeroSamples;
+		std::vector<uint32_t> oneSamples;
+		uint64_t bits;
+		uint64_t ones;
+
+		uint64_t select(uint64_t k, bool one) const;
+};
+
+// fixed-width unsigned integers packed into 64-bit words
+class PackedArray {
+	public:
+		PackedArray() : width(0), count(0) { }
+		void init(int width, uint64_t count);
+		void clear() { words.clear(); width = 0; count = 0; }
+		uint32_t get(uint64_t i) const;
+		void set(uint64_t i, uint32_t value);
+		uint64_t size() const { return count; }
+		size_t getSize() const { return words.size() * sizeof(uint64_t); }
+		const uint64_t* address(uint64_t i) const { return &words[(i * width) >> 6]; }
+
+	private:
+		std::vector<uint64_t> words;
+		int width;
+		uint64_t count;
+};
+
+/*
+ * Succinct trie in level-order unary degree sequence (LOUDS) form, built
+ * straight from the trie file's breadth-first stream of child masks. Nodes
+ * are numbered in stream order; node k contributes one 1 bit per child and a
+ * terminating 0 to 'tree', so its block starts right after the k-th zero and
+ * its first child is node (block start - k + 1). Edge labels are 5-bit
+ * letters in the same order as the 1 bits. Leaves are numbered in stream
+ * order by rank over 'leaves'; 'ids' maps that rank to the lexicographic word
+ * ID the other layouts use. Stream order is depth, then lexicographic, so
+ * the IDs of one depth's leaves increase and getWord() finds a word by a
+ * binary search per depth rather than through an inverse array: on the
+ * default dictionary 'ids' costs about 8.6 of 17 bits per node, and the
+ * solvers read it once per word found. A trie that shares
+ * another's holds no bits of its own: LoudsTrieView and getWord() read the
+ * owner's.
+ */
+class LoudsTrie {
+	public:
+		LoudsTrie();
+		void clear();
+		bool build(const uint32_t* masks, uint32_t count);
+		void share(const LoudsTrie& trie);
+		const LoudsTrie& getOwner() const { return (owner != NULL) ? *owner : *this; }
+		bool load(const char* fileName);
+		bool getWord(uint32_t wordId, string& word) const;
+		uint32_t getNodeCount() const { return nodeCount; }
+		uint32_t getWordCount() const { return wordCount; }
+		size_t getSize() const;
+
+		// navigation
+		uint64_t blockStart(uint32_t node) const { return (node == 0) ? 0 : tree.select0(node - 1) + 1; }
+		uint32_t child(uint32_t node, uint64_t start, int index) const;
+		uint32_t childMask(uint32_t node, uint64_t start) const;
+		bool isLeaf(uint32_t node) const { return leaves.get(node); }
+		uint32_t wordId(uint32_t node) const { return ids.get(leaves.rank1(node)); }
+		const uint64_t* labelWord(uint64_t edge) const;
+
+	private:
+		BitVector tree;
+		BitVector leaves;
+		PackedArray labels;
+		PackedArray ids;
+		std::vector<uint32_t> levelLeaves;	// rank of each depth's first leaf, then wordCount
+		uint32_t nodeCount;
+		uint32_t wordCount;
+		const LoudsTrie* owner;		// trie whose bits this one reads, NULL for its own
+
+		LoudsTrie(LoudsTrie const&);
+		LoudsTrie& operator=(LoudsTrie const&);
+
+		uint32_t assignWordIds(uint32_t node, uint32_t nextId);
+		uint32_t parent(uint32_t node) const;
+};
+
+// solver access to the LOUDS layout; see PointerTrieView
+struct LoudsTrieView {
+	struct Node {
+		uint32_t index;
+		uint64_t start;		// position of the node's block in the tree bits
+
+		Node() : index(0), start(0) { }
+		Node(uint32_t index, uint64_t start) : index(index), start(start) { }
+		operator bool() const { return index != 0; }
+	};
+	const LoudsTrie& trie;
+
+	explicit LoudsTrieView(const LoudsTrie& trie) : trie(trie.getOwner()) { }
+	Node root() const { return Node(0, 0); }
+	Node child(Node node, int index) const {
+		uint32_t child = trie.child(node.index, node.start, index);
+		return (child != 0) ? Node(child, trie.blockStart(child)) : Node();
+	}
+	uint32_t childMask(Node node) const { return trie.childMask(node.index, node.start); }
+	bool isLeaf(Node node) const { return trie.isLeaf(node.index); }
+	uint32_t wordId(Node node) const { return trie.wordId(node.index); }
+	void prefetchChild(Node node, int) const { __builtin_prefetch(trie.labelWord(node.start - node.index)); }
+};
+
+#endif	// LOUDSTRIE_H_
@@ -0,0 +1,69 @@
+#ifndef NODEPOOL_H_
+#define NODEPOOL_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#define HUGE_PAGE_SIZE (1u << 21)
+#define POOL_CHUNK_SIZE (HUGE_PAGE_SIZE * 8)
+
+enum PageMode {
+	PAGES_DEFAULT,		// regular pages
+	PAGES_TRANSPARENT,	// madvise(MADV_HUGEPAGE), Linux only
+	PAGES_EXPLICIT		// MAP_HUGETLB, Linux only; falls back to transparent
+};
+
+const char* pageModeName(PageMode mode);
+bool parsePageMode(const char* name, PageMode& mode);
+
+/*
+ * Page-backed memory for trie storage. The mode actually granted is returned
+ * in 'actual'; when huge pages are not available the request degrades to the
+ * next mode down instead of failing. Every mode maps whole huge pages, so
+ * freePages needs only the size asked for.
+ */
+void* allocPages(size_t size, PageMode mode, PageMode& actual);
+void freePages(void* memory, size_t size);
+
+/*
+ * Fixed-size node arena: nodes are carved out of POOL_CHUNK_SIZE chunks
+ * obtained with allocPages, so the trie stays packed in few pages. Chunks are
+ * unmapped once every node has been freed.
+ */
+class NodePool {
+	public:
+		~NodePool();
+		static NodePool* Instance();
+		void* allocate(size_t size);
+		void deallocate(void* node);
+		PageMode getPageMode();
+		PageMode getGrantedPageMode();
+		void setPageMode(PageMode mode);
+		size_t getMappedBytes();
+
+	private:
+		struct Chunk {
+			char* memory;
+			PageMode mode;
+		};
+
+		static NodePool* instance;
+		std::mutex lock;
+		std::vector<Chunk> chunks;
+		void* freeList;
+		size_t chunkUsed;
+		size_t nodeSize;
+		uint64_t live;
+		PageMode mode;
+		PageMode granted;
+
+		NodePool();
+		NodePool(NodePool const&);
+		NodePool& operator=(NodePool const&);
+
+		void releaseChunks();
+};
+
+#endif	// NODEPOOL_H_
@@ -0,0 +1,42 @@
+#ifndef PATTERN_H_
+#define PATTERN_H_
+
+#include <cinttypes>
+#include <string>
+
+#define PATTERN_MAX_TOKENS 63	// one state bit per token plus the accepting state
+#define ALL_LETTERS ((1u << 26) - 1)
+
+using std::string;
+
+/*
+ * Word pattern compiled to a small NFA whose state set fits in a uint64_t.
+ * Syntax, case-insensitive:
+ *   A-Z      that letter
+ *   ?        any one letter
+ *   [AEIOU]  one letter of the class; ranges ([A-F]) and negation ([^QXZ])
+ *   *        any run of letters, including none
+ * State i means "token i is next"; state n (the token count) accepts. A trie
+ * walk carries the state set down the tree, so each node is visited once and
+ * only the letters some live state accepts are followed.
+ */
+class Pattern {
+	public:
+		Pattern() : tokenCount(0) { }
+		bool parse(const string& pattern);
+		uint64_t start() const { return closure(1); }
+		uint64_t step(uint64_t states, int letter) const;
+		uint32_t letters(uint64_t states) const;
+		bool accepts(uint64_t states) const { return (states >> tokenCount) & 1; }
+
+	private:
+		int tokenCount;
+		uint32_t masks[PATTERN_MAX_TOKENS];		// letters token i accepts
+		uint64_t stars;		// tokens that may repeat or be skipped
+		uint64_t advance[26];	// states a letter moves forward one token
+		uint64_t stay[26];		// states a letter leaves in place
+
+		uint64_t closure(uint64_t states) const;
+};
+
+#endif	// PATTERN_H_
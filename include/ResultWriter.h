@@ -0,0 +1,57 @@
+#ifndef RESULTWRITER_H_
+#define RESULTWRITER_H_
+
+#include <cinttypes>
+#include <iostream>
+
+#include "Boggle.h"
+
+#define WRITER_BUFFER (1 << 16)
+#define WRITER_RESERVE 128	// room for one formatted line or record header
+
+enum OutputFormat {
+	FORMAT_TEXT,	// board grid, word list, per-length counts and total points
+	FORMAT_JSON,	// one JSON object per board
+	FORMAT_BINARY	// fixed header and word IDs per board, native byte order
+};
+
+/*
+ * Buffers solve results and hands them to the stream in WRITER_BUFFER sized
+ * writes, never flushing per line. Word paths, when the solve kept them,
+ * follow their words as board cell indexes in the text and JSON formats.
+ * Binary records are laid out as:
+ *
+ *     char     board[BOARD_CELLS]
+ *     uint32_t points
+ *     uint32_t wordCount
+ *     uint32_t wordIds[wordCount]
+ */
+class ResultWriter {
+	public:
+		ResultWriter(std::ostream& stream, OutputFormat format, bool listWords = true);
+		~ResultWriter();
+		void flush();
+		bool needsWords() { return listWords && (format != FORMAT_BINARY); }
+		bool needsWordIds() { return listWords && (format == FORMAT_BINARY); }
+		void write(const char* letters, const SolveResult& result);
+
+	private:
+		std::ostream& stream;
+		OutputFormat format;
+		bool listWords;
+		char* buffer;
+		size_t bufferSize;
+
+		ResultWriter(ResultWriter const&);
+		ResultWriter& operator=(ResultWriter const&);
+
+		void append(const char* data, size_t len);
+		void appendf(const char* fmt, ...);
+		void appendPath(const WordPath& path);
+		void reserve(size_t len);
+		void writeText(const char* letters, const SolveResult& result);
+		void writeJson(const char* letters, const SolveResult& result);
+		void writeBinary(const char* letters, const SolveResult& result);
+};
+
+#endif	// RESULTWRITER_H_
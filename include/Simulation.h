@@ -0,0 +1,72 @@
+#ifndef SIMULATION_H_
+#define SIMULATION_H_
+
+#include <cinttypes>
+#include <iostream>
+#include <vector>
+
+#include "Boggle.h"
+
+#define STATS_MAGIC 0x32534f42u	// "BOS2"
+#define SIM_BATCH 50000u		// boards between merges and checkpoints
+#define SIM_CHUNK 256u			// boards a thread claims at a time
+#define REPORT_TOP_WORDS 25
+#define REPORT_SCORE_BUCKET 50
+
+/*
+ * Totals over boards seed, seed + 1, ... seed + boards - 1. Checkpoint files
+ * hold a StatsHeader followed by the uint64_t arrays wordCounts[WORD_COUNTS],
+ * scores[scoreCount] and wordFrequency[wordCount], in native byte order.
+ * dictionaryHash is the root hash of the words the totals count.
+ */
+struct StatsHeader {
+	uint32_t magic;
+	uint32_t seed;
+	uint64_t boards;
+	uint32_t wordCount;
+	uint32_t scoreCount;
+	uint64_t dictionaryHash;
+};
+
+struct BoardStats {
+	unsigned int seed;
+	uint64_t dictionaryHash;
+	uint64_t boards;
+	uint64_t wordCounts[WORD_COUNTS];	// words found, index is length - MIN_WORD_LENGTH
+	std::vector<uint64_t> scores;		// boards by total points
+	std::vector<uint64_t> wordFrequency;	// boards containing each word ID
+
+	BoardStats() : seed(0), dictionaryHash(0), boards(0), wordCounts() { }
+
+	void clear(unsigned int seed, uint32_t wordCount, uint64_t dictionaryHash);
+	void add(const SolveResult& result);
+	void merge(const BoardStats& stats);
+	bool load(const char* fileName);
+	bool save(const char* fileName) const;
+	void report(std::ostream& stream, Boggle& boggle) const;
+};
+
+/*
+ * Solves seeded boards on a pool of threads, one Boggle per thread over the
+ * shared dictionary. Threads keep their own BoardStats and are merged every
+ * SIM_BATCH boards, when the totals are also checkpointed; a run that finds
+ * a checkpoint for the same seed and dictionary, by root hash, resumes from it.
+ */
+class Simulation {
+	public:
+		Simulation(Boggle& boggle, unsigned int threads);
+		~Simulation();
+		bool run(uint64_t boards, unsigned int seed, const char* checkpointFileName, BoardStats& stats);
+
+	private:
+		std::vector<Boggle*> workers;	// workers[0] is the caller's Boggle
+		uint32_t wordCount;
+		uint64_t dictionaryHash;
+
+		Simulation(Simulation const&);
+		Simulation& operator=(Simulation const&);
+
+		void runBatch(uint64_t first, uint64_t last, unsigned int seed, std::vector<BoardStats>& threadStats);
+};
+
+#endif	// SIMULATION_H_
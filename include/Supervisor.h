@@ -0,0 +1,83 @@
+#ifndef SUPERVISOR_H_
+#define SUPERVISOR_H_
+
+#include <cinttypes>
+#include <deque>
+#include <map>
+#include <sys/types.h>
+#include <vector>
+
+#include "Boggle.h"
+#include "ResultWriter.h"
+
+#define SUPERVISOR_CHUNK 16u	// boards per job
+#define SUPERVISOR_RETRIES 2	// worker crashes on one board before it is skipped
+
+/*
+ * Worker record, read from the result pipe in native byte order:
+ *
+ *     WorkerRecord header
+ *     uint32_t     wordIds[header.wordCount]
+ */
+struct WorkerRecord {
+	uint64_t position;	// board position in the run, its seed less the first seed
+	int32_t points;
+	uint32_t wordCount;
+	uint32_t complete;
+	int32_t wordCounts[WORD_COUNTS];
+	char board[BOARD_CELLS];
+};
+
+/*
+ * Solves seeded boards on forked worker processes. The workers inherit the
+ * caller's Boggle, dictionary layouts included, and only read the trie, so
+ * its pages stay shared copy-on-write with the supervisor: resident memory
+ * is about one dictionary however many workers run. Jobs go down a pipe per
+ * worker, a uint32_t count of up to SUPERVISOR_CHUNK followed by as many
+ * uint64_t board positions, and WorkerRecords come back up another. A
+ * worker that dies is forked again and its unanswered boards handed out
+ * again; a board that has crashed SUPERVISOR_RETRIES workers is skipped.
+ * Results are written in seed order.
+ *
+ * Fork from a quiet process: no journal compaction running.
+ */
+class Supervisor {
+	public:
+		Supervisor(Boggle& boggle, unsigned int workers);
+		virtual ~Supervisor();
+		bool run(uint64_t boards, unsigned int seed, ResultWriter& writer, SolveOptions options = SolveOptions());
+		unsigned int getRestarts() { return restarts; }
+		unsigned int getSkipped() { return skipped; }
+
+	protected:
+		// runs in the worker
+		virtual void solveBoard(unsigned int seed, SolveResult& result, const SolveOptions& options);
+
+	private:
+		struct Worker {
+			pid_t pid;
+			int jobFd;		// supervisor's end of the job pipe
+			int resultFd;	// supervisor's end of the result pipe
+			std::vector<char> buffer;	// result bytes not yet parsed
+			std::deque<uint64_t> boards;	// boards sent and not yet answered, in job order
+		};
+
+		Boggle& boggle;
+		std::vector<Worker> workers;
+		unsigned int seed;		// seed of the run's first board
+		unsigned int restarts;
+		unsigned int skipped;
+
+		Supervisor(Supervisor const&);
+		Supervisor& operator=(Supervisor const&);
+
+		bool supervise(uint64_t boards, ResultWriter& writer, const SolveOptions& options);
+		bool startWorker(size_t w, const SolveOptions& options);
+		void stopWorkers();
+		void workerLoop(int jobFd, int resultFd, const SolveOptions& options);
+		bool sendJob(Worker& worker, std::deque<uint64_t>& queue, uint64_t& next, uint64_t end);
+		void parseResults(Worker& worker, std::map<uint64_t, SolveResult>& ready, std::map<uint64_t, string>& boards);
+		void reportMemory();
+};
+
+#endif	// SUPERVISOR_H_
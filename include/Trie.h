@@ -4,16 +4,40 @@
 #include <cinttypes>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include "Logger.h"
 
 #define charToIndex(c) ((int)c - (int)'A')
 #define indexToChar(i) ((char)i + (char)'A')
 
+#define TRIE_LAYOUT_MAGIC 0x594c4f42u	// "BOLY", ends a trie file that carries a node layout
+#define TRIE_HASH_MAGIC 0x53484f42u		// "BOHS", ends a trie file that carries its root hash
+#define TRIE_DICTS_MAGIC 0x54444f42u	// "BODT", ends the membership of words in overlay dictionaries
+
+// overlay dictionaries: word lists sharing one trie, bit d of a set for list d
+#define TRIE_DICTS 8
+#define DICT_BASE 0x01u		// the dictionary file's own list
+#define DICTS_ALL 0xffu
+
+#define HASH_NODE 0x6a09e667f3bcc908ull		// starting hash of a node that ends no word
+#define HASH_LEAF 0xbb67ae8584caa73bull		// and of one that ends a word
+
 using std::ifstream;
 using std::ofstream;
 using std::string;
 
+// splitmix64 finalizer
+static inline uint64_t mixHash(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+
+	return x;
+}
+
 struct TrieNode {
 #if DEBUG
 	uint64_t id;
@@ -21,9 +45,17 @@ struct TrieNode {
 #endif
 	TrieNode* children[26];
 	bool isLeaf;
+	uint8_t dicts;		// dictionaries holding the word ending here, none on other nodes
+	uint8_t below;		// dictionaries holding a word in this subtree
+	uint32_t wordId;	// ID of the first word in this subtree; the word's own ID on leaves
+	uint64_t hash;		// structure of the subtree: leaf flags and child letters
 
 	TrieNode();
 	~TrieNode();
+
+	// nodes live in the NodePool arena
+	static void* operator new(size_t size);
+	static void operator delete(void* node);
 };
 
 struct LinkedTrieNode {
@@ -59,11 +91,26 @@ class Trie {
 		~Trie();
 		void clearTrie();
 		TrieNode* getRoot();
-		void insert(const char* key, int len);
+		void insert(const char* key, int len, uint8_t dicts = DICT_BASE);
+		// takes the word out of 'dicts'; it leaves the trie with its last dictionary
+		bool erase(const char* key, int len, uint8_t dicts = DICTS_ALL);
+		uint8_t getDictionaries() { return root.below; }
+		uint32_t assignWordIds();
+		bool getWord(uint32_t wordId, string& word);
+		// structural equality, by root hash
 		bool trieCompare(Trie& trie);
+		uint64_t getHash();
+		void rehash();
+		// words only 'trie' has and words only this trie has
+		void diff(Trie& trie, std::vector<string>& added, std::vector<string>& removed);
 		bool serialize(const char* fileName);
 		bool deserialize(const char* fileName);
+		static bool readFileHash(const char* fileName, uint64_t& hash);
+		void getMasks(std::vector<uint32_t>& masks);
 		TrieInfo getTrieInfo();
+		// node placement order, as breadth-first node indices, hottest first
+		void setLayout(const std::vector<uint32_t>& order) { layout = order; }
+		const std::vector<uint32_t>& getLayout() { return layout; }
 
 	private:
 #if DEBUG
@@ -71,10 +118,75 @@ class Trie {
 		static uint64_t createTrieId() { static uint64_t nextTId = 0; return nextTId++; }
 #endif
 		TrieNode root;
-
+		std::vector<uint32_t> layout;
+		bool hashed;	// node hashes are current; insert and erase clear it
+
+		bool readLayout(ifstream& file, size_t& nodeBytes);
+		static bool readHash(ifstream& file, size_t& nodeBytes, uint64_t& hash);
+		static bool readDicts(ifstream& file, size_t& nodeBytes, std::vector<uint8_t>& dicts);
+		static uint64_t hashNode(TrieNode* node);
+		static void diffNodes(TrieNode* node, TrieNode* other, string& word, std::vector<string>& added,
+			std::vector<string>& removed);
+		static void collectWords(TrieNode* node, string& word, std::vector<string>& words);
 		TrieInfo getTrieNodeInfo(TrieNode* node);
+		static uint32_t assignNodeWordIds(TrieNode* node, uint32_t nextId);
 		static LinkedTrieNode* nodeToUint32(uint32_t& output, TrieNode* node, LinkedTrieNode* tail);
-		static LinkedTrieNode* uint32ToNode(uint32_t input, TrieNode* node, LinkedTrieNode* tail);
+		static LinkedTrieNode* uint32ToNode(uint32_t input, TrieNode* node, LinkedTrieNode* tail,
+			std::vector<TrieNode*>& placed, size_t& nextPlaced);
+};
+
+/*
+ * Solver access to the pointer trie. Trie views share this interface, with a
+ * false Node meaning "no child", so the search engines can walk any layout.
+ */
+struct PointerTrieView {
+	typedef TrieNode* Node;
+	TrieNode* rootNode;
+
+	explicit PointerTrieView(Trie& trie) : rootNode(trie.getRoot()) { }
+	Node root() const { return rootNode; }
+	Node child(Node node, int index) const { return node->children[index]; }
+	uint32_t childMask(Node node) const {
+		uint32_t mask = 0;
+		for (int k = 0; k < 26; k++) { mask |= (node->children[k] != NULL) ? (1u << k) : 0; }
+		return mask;
+	}
+	bool isLeaf(Node node) const { return node->isLeaf; }
+	uint32_t wordId(Node node) const { return node->wordId; }
+	void prefetchChild(Node node, int index) const {
+		// the node the child pointer leads to, where the next move will stall
+		TrieNode* child = node->children[index];
+		if (child != NULL) { __builtin_prefetch(child); }
+	}
+};
+
+/*
+ * PointerTrieView over the words of the selected overlay dictionaries only:
+ * a subtree without one of their words has no edge into it, so the search
+ * never enters it. Word IDs are still those of the whole trie.
+ */
+struct OverlayTrieView {
+	typedef TrieNode* Node;
+	TrieNode* rootNode;
+	uint8_t dicts;
+
+	OverlayTrieView(Trie& trie, uint8_t dicts) : rootNode(trie.getRoot()), dicts(dicts) { }
+	Node root() const { return rootNode; }
+	Node child(Node node, int index) const {
+		TrieNode* child = node->children[index];
+		return ((child != NULL) && (child->below & dicts)) ? child : NULL;
+	}
+	uint32_t childMask(Node node) const {
+		uint32_t mask = 0;
+		for (int k = 0; k < 26; k++) { mask |= child(node, k) ? (1u << k) : 0; }
+		return mask;
+	}
+	bool isLeaf(Node node) const { return (node->dicts & dicts) != 0; }
+	uint32_t wordId(Node node) const { return node->wordId; }
+	void prefetchChild(Node node, int index) const {
+		TrieNode* child = node->children[index];
+		if (child != NULL) { __builtin_prefetch(child); }
+	}
 };
 
 #endif	// TRIE_H_
@@ -0,0 +1,98 @@
+#include "BoardWalk.h"
+
+const Neighbors neighbors;
+
+Neighbors::Neighbors() {
+	for (int c = 0; c < BOARD_CELLS; c++) {
+		int i = c / BOARD_SIZE, j = c % BOARD_SIZE, n = 0;
+		for (int mi = i - 1; mi <= i + 1; mi++) {
+			for (int mj = j - 1; mj <= j + 1; mj++) {
+				bool inBoard = (mi >= 0) && (mi < BOARD_SIZE) && (mj >= 0) && (mj < BOARD_SIZE);
+				if (inBoard && ((mi != i) || (mj != j))) {
+					cells[c][n++] = mi * BOARD_SIZE + mj;
+				}
+			}
+		}
+		cells[c][n] = -1;
+	}
+}
+
+/****************
+ * WordIterator *
+ ****************/
+
+WordIterator::WordIterator(Boggle& boggle, bool prefetch) : boggle(boggle), prefetch(prefetch) {
+	compactWalk = NULL;
+	pointerWalk = NULL;
+	loudsWalk = NULL;
+	points = 0;
+	reset();
+}
+
+WordIterator::~WordIterator() {
+	clearWalks();
+}
+
+void WordIterator::clearWalks() {
+	delete compactWalk;
+	delete pointerWalk;
+	delete loudsWalk;
+	compactWalk = NULL;
+	pointerWalk = NULL;
+	loudsWalk = NULL;
+}
+
+void WordIterator::reset() {
+	if (boggle.dirty) { boggle.refreshLayouts(); }
+	for (size_t w = 0; w < yielded.size(); w++) {
+		seen[yielded[w] / 64] &= ~(1ull << (yielded[w] % 64));
+	}
+	yielded.clear();
+	points = 0;
+
+	// the layouts may have been rebuilt since the last board
+	clearWalks();
+	char board[BOARD_CELLS + 1];
+	boggle.getBoard(board);
+	if (boggle.layouts & LAYOUT_COMPACT) {
+		compactWalk = new BoardWalk<CompactTrieView>(CompactTrieView(boggle.compact), prefetch);
+		compactWalk->reset(board);
+	} else if (boggle.layouts & LAYOUT_POINTER) {
+		pointerWalk = new BoardWalk<PointerTrieView>(PointerTrieView(boggle.dictionary), prefetch);
+		pointerWalk->reset(board);
+	} else {
+		loudsWalk = new BoardWalk<LoudsTrieView>(LoudsTrieView(boggle.louds), prefetch);
+		loudsWalk->reset(board);
+	}
+}
+
+bool WordIterator::next(uint32_t& wordId, int& len) {
+	FoundWord word;
+	while (true) {
+		bool more = (compactWalk != NULL) ? compactWalk->next(word)
+			: (pointerWalk != NULL) ? pointerWalk->next(word) : loudsWalk->next(word);
+		if (!more) {
+			return false;
+		}
+
+		// only the first path to a word counts
+		if (word.wordId / 64 >= seen.size()) {
+			seen.resize(word.wordId / 64 + 1, 0);
+		}
+		uint64_t bit = 1ull << (word.wordId % 64);
+		if (!(seen[word.wordId / 64] & bit)) {
+			seen[word.wordId / 64] |= bit;
+			yielded.push_back(word.wordId);
+			points += Boggle::wordPoints(word.len);
+			wordId = word.wordId;
+			len = word.len;
+			return true;
+		}
+	}
+}
+
+bool WordIterator::next(string& word) {
+	uint32_t wordId;
+	int len;
+	return next(wordId, len) && boggle.getWord(wordId, word);
+}
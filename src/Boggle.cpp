@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
@@ -5,7 +8,9 @@
 #include <time.h>
 #include <typeinfo>
 
+#include "BoardWalk.h"
 #include "Boggle.h"
+#include "ResultWriter.h"
 
 #define DICT_FILE "BoggleWords.dict"
 #define TRIE_FILE "BoggleWords.trie"
@@ -13,86 +18,262 @@
 #define EACH_J (int j = 0; j < 5; j++)
 #define inRange(i) ((i >= 0) && (i < 5))
 
-using std::list;
+// cost model weights (ns), calibrated on seeded boards against the full
+// dictionary and 1/20 and 1/200 samples of it
+#define BOARD_COST 26.0	// per sqrt(prefix subtree nodes) per adjacent cell pair, compact engine
+#define DICT_COST 6.0		// per prefix subtree node reachable through board bigrams
 
-Boggle::Boggle() {
-	dictionary = Trie();
-	words = list<string>();
+#define LAYOUT_HOT_NODES 4096u	// head of the profiled layout reported as "hot"
+
+// cell bits of the board's first and last columns, and of the whole board
+#define COLUMN_FIRST 0x0108421u
+#define COLUMN_LAST 0x1084210u
+#define BOARD_MASK ((1u << BOARD_CELLS) - 1)
+
+using std::vector;
+using std::chrono::steady_clock;
+
+// SolveMetrics, shared by every Boggle in the process
+static std::atomic<uint64_t> solveCount(0), boundedCount(0), timeoutCount(0), cancelCount(0);
+
+// CompactTrieView that counts reads of each node during a search
+struct ProfileTrieView {
+	typedef uint32_t Node;
+	CompactTrieView view;
+	uint64_t* visits;
+
+	ProfileTrieView(const CompactTrie& trie, uint64_t* visits) : view(trie), visits(visits) { }
+	Node root() const { return view.root(); }
+	Node child(Node node, int index) const { visits[node]++; return view.child(node, index); }
+	uint32_t childMask(Node node) const { visits[node]++; return view.childMask(node); }
+	bool isLeaf(Node node) const { return view.isLeaf(node); }
+	uint32_t wordId(Node node) const { return view.wordId(node); }
+	void prefetchChild(Node, int) const { }
+};
+
+// quChild for the recursive engines
+static inline TrieNode* quChild(TrieNode* node) {
+	TrieNode* child = node->children[Q_INDEX];
+	return (child != NULL) ? child->children[U_INDEX] : NULL;
+}
+
+// cells next to any of 'cells', shifting the whole set one step each way
+static inline uint32_t adjacentCells(uint32_t cells) {
+	uint32_t east = cells & ~COLUMN_LAST, west = cells & ~COLUMN_FIRST;	// cells with a neighbor that way
+	return ((east << 1) | (west >> 1) | (cells << BOARD_SIZE) | (cells >> BOARD_SIZE) | (east << (BOARD_SIZE + 1))
+		| (west << (BOARD_SIZE - 1)) | (east >> (BOARD_SIZE - 1)) | (west >> (BOARD_SIZE + 1))) & BOARD_MASK;
+}
+
+/*
+ * Upper bound on a board's points. Letting a path revisit cells, the cells a
+ * prefix can end on depend on the prefix alone, so one walk of the trie that
+ * carries them as a bit set visits every node at most once and counts every
+ * word once. Two facts about real paths win most of the precision back: a
+ * cell that is the only place a prefix can end is on every path spelling it,
+ * so longer prefixes can't return to it, and a prefix needing more of some
+ * letters than the board shows, beyond what its blanks cover, is cut.
+ */
+template <class View>
+struct ScoreBound {
+	typedef typename View::Node Node;
+	const View& view;
+	uint32_t letterCells[26];	// cells that can read each letter, blanks included; Q cells read "QU"
+	uint32_t rowLetters[BOARD_SIZE][1 << BOARD_SIZE];	// letters some cell of a row's cell set can read
+	int letters[26];	// cells showing each letter
+	int used[26];		// of each letter, those the prefix takes from cells; the U of a Q cell is free
+	int blanks;
+	int deficit;		// letters the prefix takes beyond the board's, each needing a blank
+	int points;
+
+	ScoreBound(const View& view, const char* board) : view(view), letterCells(), letters(), used(), blanks(0),
+		deficit(0), points(0) {
+		uint32_t cellLetters[BOARD_CELLS];
+		for (int c = 0; c < BOARD_CELLS; c++) {
+			if (board[c] == BLANK_CELL) {
+				blanks++;
+				cellLetters[c] = (1u << 26) - 1;
+				for (int a = 0; a < 26; a++) { letterCells[a] |= 1u << c; }
+			} else {
+				letters[charToIndex(board[c])]++;
+				letterCells[charToIndex(board[c])] |= 1u << c;
+				cellLetters[c] = 1u << charToIndex(board[c]);
+			}
+		}
+		for (int row = 0; row < BOARD_SIZE; row++) {
+			for (uint32_t cells = 0; cells < (1u << BOARD_SIZE); cells++) {
+				rowLetters[row][cells] = 0;
+				for (int j = 0; j < BOARD_SIZE; j++) {
+					if (cells & (1u << j)) { rowLetters[row][cells] |= cellLetters[row * BOARD_SIZE + j]; }
+				}
+			}
+		}
+	}
+
+	void search(Node node, uint32_t cells, uint32_t taken, int len) {
+		if (view.isLeaf(node) && (len >= MIN_WORD_LENGTH)) {
+			points += Boggle::wordPoints(len);
+		}
+
+		// only the letters the next cells can read; 'taken' holds the cells every path has used
+		uint32_t next = ((len == 0) ? BOARD_MASK : adjacentCells(cells)) & ~taken;
+		uint32_t nextLetters = 0;
+		for (int row = 0; row < BOARD_SIZE; row++) {
+			nextLetters |= rowLetters[row][(next >> (row * BOARD_SIZE)) & ((1u << BOARD_SIZE) - 1)];
+		}
+
+		for (uint32_t children = view.childMask(node) & nextLetters; children != 0; children &= children - 1) {
+			int index = __builtin_ctz(children);
+			Node child = (index == Q_INDEX) ? quChild(view, node) : view.child(node, index);
+			if (!child) { continue; }
+
+			if (++used[index] > letters[index]) { deficit++; }
+			if (deficit <= blanks) {
+				// a prefix that can end on one cell only takes that cell on every path
+				uint32_t reach = next & letterCells[index];
+				uint32_t single = ((reach & (reach - 1)) == 0) ? reach : 0;
+				search(child, reach, taken | single, len + ((index == Q_INDEX) ? 2 : 1));
+			}
+			if (used[index]-- > letters[index]) { deficit--; }
+		}
+	}
+};
+
+static uint32_t countNodes(TrieNode* node) {
+	uint32_t count = 1;
+	for (int k = 0; k < 26; k++) {
+		if (node->children[k] != NULL) {
+			count += countNodes(node->children[k]);
+		}
+	}
+
+	return count;
+}
+
+Boggle::Boggle(int layouts) {
+	this->layouts = layouts;
+	dirty = false;
+	completionRank = RANK_POINTS;
+	trieFile = TRIE_FILE;
 	clearBoard();
 	clearVisited();
 	loadDice();
-	loadDict();
+#if EMBEDDED_DICT
+	if (compact.attachEmbedded()) {
+		LOG_INFO("Using embedded dictionary.");
+		this->layouts = LAYOUT_COMPACT;
+		// no pointer trie to count prefixes in; the engine is ENGINE_COMPACT anyway
+		std::memset(prefixNodes, 0, sizeof(prefixNodes));
+		return;
+	}
+	LOG_ERROR("Embedded dictionary is unusable, loading from file.");
+#endif
+	loadDict(DICT_FILE, TRIE_FILE);
+	loadPrefixNodes();
+	loadLayouts();
 }
 
-Boggle::~Boggle() {
+Boggle::Boggle(const char* dictFileName, const char* trieFileName, int layouts) {
+	this->layouts = layouts;
+	dirty = false;
+	completionRank = RANK_POINTS;
+	trieFile = trieFileName;
+	clearBoard();
+	clearVisited();
+	loadDice();
+	loadDict(dictFileName, trieFileName);
+	loadPrefixNodes();
+	loadLayouts();
 }
 
-void Boggle::clearBoard() {
-	for EACH_I {
-		for EACH_J {
-			board[i][j] = 0;
-		}
+Boggle::Boggle(const DiceSet& dice, int layouts) {
+	this->layouts = layouts;
+	dirty = false;
+	completionRank = RANK_POINTS;
+	diceSet = dice;
+	trieFile = dice.keyedFileName(TRIE_FILE);
+	clearBoard();
+	clearVisited();
+	loadDice();
+
+	ifstream file(trieFile.c_str());
+	bool compiled = file.is_open();
+	file.close();
+	loadDict(DICT_FILE, trieFile.c_str());
+	if (!compiled) {
+		filterDictionary(dice);
+	} else {
+		loadPrefixNodes();
 	}
+	refreshLayouts();
 }
 
-void Boggle::clearVisited() {
-	for EACH_I {
-		for EACH_J {
-			visited[i][j] = false;
-		}
-	}
+Boggle::Boggle(Boggle* dictionarySource) {
+	// another solver over the source's dictionary, for use on another thread
+	dirty = false;
+	completionRank = RANK_POINTS;
+	clearBoard();
+	clearVisited();
+	loadDice();
+	shareDictionary(dictionarySource);
 }
 
-void Boggle::findWords() {
+Boggle::Boggle(const char* compactFileName) {
+	dirty = false;
+	completionRank = RANK_POINTS;
+	trieFile = compactFileName;
+	clearBoard();
 	clearVisited();
-	words = list<string>();
+	loadDice();
+	// no pointer trie to count prefixes in; the engine is ENGINE_COMPACT anyway
+	std::memset(prefixNodes, 0, sizeof(prefixNodes));
+	layouts = compact.map(compactFileName) ? LAYOUT_COMPACT : 0;
+	if (layouts == 0) {
+		LOG_ERROR("Unable to map compact trie file '%s'.", compactFileName);
+	}
+}
 
-	TrieNode* child = dictionary.getRoot();
-	string str = "";
+void Boggle::shareDictionary(Boggle* dictionarySource) {
+	trieFile = dictionarySource->trieFile;
+	diceSet = dictionarySource->diceSet;
+	std::memcpy(prefixNodes, dictionarySource->prefixNodes, sizeof(prefixNodes));
+	completer.clear();
+	if (dictionarySource->layouts & LAYOUT_COMPACT) {
+		compact.share(dictionarySource->compact);
+		louds.clear();
+		layouts = LAYOUT_COMPACT;
+	} else if (dictionarySource->layouts & LAYOUT_POINTER) {
+		// built once, on the source, so every sharer reads the same copy
+		LOG_INFO("Building the compact layout to share the dictionary.");
+		dictionarySource->compact.build(dictionarySource->dictionary);
+		dictionarySource->layouts |= LAYOUT_COMPACT;
+		compact.share(dictionarySource->compact);
+		louds.clear();
+		layouts = LAYOUT_COMPACT;
+	} else {
+		compact.clear();
+		louds.share(dictionarySource->louds);
+		layouts = LAYOUT_LOUDS;
+	}
+}
 
+Boggle::~Boggle() {
+}
+
+void Boggle::clearBoard() {
+	blanks = 0;
 	for EACH_I {
 		for EACH_J {
-			int index = charToIndex(board[i][j]);
-			if (child->children[index]) {
-				str = str + board[i][j];
-				searchWord(child->children[index], i, j, str);
-				str = "";
-			}
-		}
-	}
-
-	words.sort();
-	words.unique();
-	list<string>::const_iterator iterator, end;
-	int points = 0;
-	int wordCounts[24] = { };
-	for (iterator = words.begin(), end = words.end(); iterator != end; iterator++) {
-		std::cout << *iterator << std::endl;
-		int len = (*iterator).length();
-		if (len < 4) {
-			printf("Word '%s' is not long enough\n", (*iterator).c_str());
-			continue;
-		}
-		if (len > 27) {
-			printf("Word '%s' is too long for board\n", (*iterator).c_str());
-			continue;
-		}
-		wordCounts[len - 4]++;
-		switch ((*iterator).length()) {
-			case 4: points += 1; break;
-			case 5: points += 2; break;
-			case 6: points += 3; break;
-			case 7: points += 5; break;
-			default: points += 11; break;
+			board[i][j] = 0;
 		}
 	}
+}
 
-	for (int i = 0; i < 24; i++) {
-		if (wordCounts[i] > 0) {
-			printf("%d-letter words: %d\n", i + 4, wordCounts[i]);
+void Boggle::clearVisited() {
+	for EACH_I {
+		for EACH_J {
+			visited[i][j] = false;
 		}
 	}
-	printf("Total points: %d\n", points);
 }
 
 bool Boggle::isSafe(int i, int j) {
@@ -100,41 +281,17 @@ bool Boggle::isSafe(int i, int j) {
 }
 
 void Boggle::loadDice() {
-	dice[0]  = "AAAFRS";
-	dice[1]  = "AAEEEE";
-	dice[2]  = "AAFIRS";
-	dice[3]  = "ADENNN";
-	dice[4]  = "AEEEEM";
-	dice[5]  = "AEEGMU";
-	dice[6]  = "AEGMNN";
-	dice[7]  = "AFIRSY";
-	dice[8]  = "BJKQXZ";
-	dice[9]  = "CCENST";
-	dice[10] = "CEIILT";
-	dice[11] = "CEILPT";
-	dice[12] = "CEIPST";
-	dice[13] = "DDHNOT";
-	dice[14] = "DHHLNO";
-	dice[15] = "DHHLOR";
-	dice[16] = "DHLNOR";
-	dice[17] = "EIIITT";
-	dice[18] = "EMOTTT";
-	dice[19] = "ENSSSU";
-	dice[20] = "FIPRSY";
-	dice[21] = "GORRVW";
-	dice[22] = "IKLQUW";
-	dice[23] = "NOOTUW";
-	dice[24] = "OOOTTU";
+	for (int d = 0; d < DICE_COUNT; d++) {
+		dice[d] = diceSet.getDie(d);
+	}
 }
 
 void Boggle::loadBoard() {
-	srand(time(NULL));
-
 	// shuffle dice with Knuth shuffle
 	int r;
 	string tmpDie;
 	for (int i = 24; i >= 1; i--) {
-		r = rand() % (i + 1);
+		r = rng() % (i + 1);
 
 		// swap
 		if (i == r) continue;
@@ -144,32 +301,434 @@ void Boggle::loadBoard() {
 	}
 
 	// select one side of each die
+	blanks = 0;
 	for EACH_I {
 		for EACH_J {
-			board[i][j] = dice[i * 5 + j][rand() % 6];
+			board[i][j] = dice[i * 5 + j][rng() % 6];
 		}
 	}
 }
 
-void Boggle::loadDict() {
-	bool ret = dictionary.deserialize(TRIE_FILE);
+void Boggle::loadDict(const char* dictFileName, const char* trieFileName) {
+	bool ret = dictionary.deserialize(trieFileName);
 	if (!ret) {
 		LOG_INFO("Trie deserializion failed. Loading trie from dictionary.");
 		string word;
 		ifstream file;
-		file.open(DICT_FILE);
+		file.open(dictFileName);
 		if (file.is_open()) {
 			while (getline(file, word)) {
 				dictionary.insert(word.c_str(), word.length());
 			}
 			file.close();
 
-			dictionary.serialize(TRIE_FILE);
+			dictionary.serialize(trieFileName);
 		}
-	}	
+	}
+
+	// edits made since the trie file was written
+	journal.open(trieFileName);
+	if (journal.replay(dictionary) >= JOURNAL_COMPACT_RECORDS) {
+		journal.startCompaction();
+	}
+	dictionary.assignWordIds();
+}
+
+void Boggle::loadLayouts() {
+	if (layouts & LAYOUT_COMPACT) {
+		compact.build(dictionary);
+	}
+	if (layouts & LAYOUT_LOUDS) {
+		std::vector<uint32_t> masks;
+		dictionary.getMasks(masks);
+		if (!louds.build(masks.data(), masks.size())) {
+			LOG_ERROR("LOUDS trie unavailable, keeping pointer trie.");
+			layouts = (layouts & ~LAYOUT_LOUDS) | LAYOUT_POINTER;
+		}
+	}
+	if (!(layouts & LAYOUT_POINTER)) {
+		// the pointer trie only served to build the other layouts
+		if (dictionary.getDictionaries() & ~DICT_BASE) {
+			LOG_INFO("Overlay dictionaries need the pointer trie; solving over every word list.");
+		}
+		dictionary.clearTrie();
+	}
+}
+
+template <class View>
+uint64_t Boggle::hashNodes(const View& view, typename View::Node node) {
+	// Trie::hashNode() over a view, whose words are all in the base list
+	uint64_t hash = view.isLeaf(node) ? HASH_LEAF : HASH_NODE;
+	for (uint32_t children = view.childMask(node); children != 0; children &= children - 1) {
+		int index = __builtin_ctz(children);
+		hash = mixHash(hash ^ mixHash(hashNodes(view, view.child(node, index)) + index + 1));
+	}
+
+	return hash;
+}
+
+template <class View>
+bool Boggle::lookupWord(const View& view, const string& word, uint32_t& wordId) {
+	typename View::Node node = view.root();
+	for (size_t i = 0; i < word.length(); i++) {
+		int index = charToIndex(toupper(word[i]));
+		if ((index < 0) || (index >= 26)) { return false; }
+		node = view.child(node, index);
+		if (!node) { return false; }
+	}
+	if (!view.isLeaf(node)) { return false; }
+	wordId = view.wordId(node);
+
+	return true;
+}
+
+template <class View>
+bool Boggle::searchPattern(const View& view, const Pattern& pattern, typename View::Node node, uint64_t states,
+	string& word, const PatternCallback& callback) {
+	if (view.isLeaf(node) && pattern.accepts(states) && !callback(word, view.wordId(node))) {
+		return false;
+	}
+
+	// only letters a live state accepts and the node has a child for
+	for (uint32_t next = pattern.letters(states) & view.childMask(node); next != 0; next &= next - 1) {
+		int index = __builtin_ctz(next);
+		word.push_back(indexToChar(index));
+		bool more = searchPattern(view, pattern, view.child(node, index), pattern.step(states, index), word, callback);
+		word.pop_back();
+		if (!more) { return false; }
+	}
+
+	return true;
+}
+
+bool Boggle::matchPattern(const string& pattern, const PatternCallback& callback) {
+	Pattern compiled;
+	if (!compiled.parse(pattern)) {
+		return false;
+	}
+	if (dirty) { refreshLayouts(); }
+
+	// matches stream out in alphabetical order
+	string word;
+	if (layouts & LAYOUT_COMPACT) {
+		searchPattern(CompactTrieView(compact), compiled, 0, compiled.start(), word, callback);
+	} else if (layouts & LAYOUT_LOUDS) {
+		LoudsTrieView view(louds);
+		searchPattern(view, compiled, view.root(), compiled.start(), word, callback);
+	} else {
+		PointerTrieView view(dictionary);
+		searchPattern(view, compiled, view.root(), compiled.start(), word, callback);
+	}
+
+	return true;
+}
+
+void Boggle::refreshLayouts() {
+	dictionary.assignWordIds();
+	loadLayouts();
+	if (completer.isBuilt()) {
+		completer.build(compact, completionRank, completionWeights.empty() ? NULL : completionWeights.c_str());
+	}
+	dirty = false;
+}
+
+static bool normalizeWord(const string& word, string& key) {
+	key = word;
+	for (size_t i = 0; i < key.length(); i++) {
+		key[i] = toupper(key[i]);
+		if ((key[i] < 'A') || (key[i] > 'Z')) { return false; }
+	}
+
+	return !key.empty();
+}
+
+// nodes already on a word's path, the root not counted
+static int pathNodes(TrieNode* node, const string& key) {
+	int depth = 0;
+	while ((depth < (int)key.length()) && ((node = node->children[charToIndex(key[depth])]) != NULL)) {
+		depth++;
+	}
+	return depth;
+}
+
+void Boggle::adjustPrefixNodes(const string& key, int before, int after) {
+	// the path's nodes from depth 2 down sit below its two-letter prefix
+	if (key.length() >= 2) {
+		prefixNodes[charToIndex(key[0])][charToIndex(key[1])] += std::max(after, 1) - std::max(before, 1);
+	}
+}
+
+bool Boggle::addWord(const string& word) {
+	string key;
+	uint32_t wordId;
+	if (!(layouts & LAYOUT_POINTER) || !normalizeWord(word, key)) {
+		return false;
+	}
+	if (lookupWord(OverlayTrieView(dictionary, DICT_BASE), key, wordId)) {
+		return true;
+	}
+
+	int before = pathNodes(dictionary.getRoot(), key);
+	dictionary.insert(key.c_str(), key.length());
+	adjustPrefixNodes(key, before, key.length());
+	dirty = true;
+	return journal.append(true, key);
+}
+
+bool Boggle::removeWord(const string& word) {
+	string key;
+	if (!(layouts & LAYOUT_POINTER) || !normalizeWord(word, key)) {
+		return false;
+	}
+	int before = pathNodes(dictionary.getRoot(), key);
+	if (!dictionary.erase(key.c_str(), key.length())) {
+		return false;
+	}
+	adjustPrefixNodes(key, before, pathNodes(dictionary.getRoot(), key));
+
+	dirty = true;
+	return journal.append(false, key);
+}
+
+bool Boggle::loadOverlay(const char* dictFileName, int index) {
+	if (!(layouts & LAYOUT_POINTER) || (index < 0) || (index >= TRIE_DICTS)) {
+		LOG_ERROR("Overlay dictionaries need the pointer trie and an index below %d.", TRIE_DICTS);
+		return false;
+	}
+	ifstream file(dictFileName);
+	if (!file.is_open()) {
+		LOG_ERROR("Unable to open dictionary file '%s'.", dictFileName);
+		return false;
+	}
+
+	// words the trie has join the list, the others are added to the trie
+	uint64_t before = dictionary.getHash();
+	uint32_t count = 0;
+	string word, key;
+	while (getline(file, word)) {
+		if (!word.empty() && (word[word.length() - 1] == '\r')) {
+			word.erase(word.length() - 1);
+		}
+		if (normalizeWord(word, key)) {
+			dictionary.insert(key.c_str(), key.length(), 1u << index);
+			count++;
+		}
+	}
+	LOG_INFO("Overlay dictionary %d has %u words from '%s'.", index, count, dictFileName);
+
+	// already in the trie file from an earlier load
+	if (dictionary.getHash() == before) {
+		return true;
+	}
+	loadPrefixNodes();
+	dirty = true;
+	return dictionary.serialize(trieFile.c_str());
+}
+
+bool Boggle::compactJournal(bool wait) {
+	bool ret = journal.startCompaction();
+	if (wait) {
+		ret = journal.waitCompaction();
+	}
+
+	return ret;
+}
+
+bool Boggle::loadCompletions(CompletionRank rank, const char* weightFileName) {
+	if (!(layouts & LAYOUT_COMPACT)) {
+		LOG_ERROR("Completions need the compact trie.");
+		return false;
+	}
+	if (dirty) { refreshLayouts(); }
+
+	completionRank = rank;
+	completionWeights = (weightFileName != NULL) ? weightFileName : "";
+	return completer.build(compact, rank, weightFileName);
+}
+
+uint32_t Boggle::complete(const string& prefix, size_t k, vector<string>& words) {
+	if (dirty) { refreshLayouts(); }
+	vector<Completion> completions;
+	uint32_t total = completer.complete(prefix, k, completions);
+
+	words.resize(completions.size());
+	for (size_t c = 0; c < completions.size(); c++) {
+		compact.getWord(completions[c].wordId, words[c]);
+	}
+
+	return total;
+}
+
+bool Boggle::filterDictionary(const DiceSet& dice) {
+	if (!(layouts & LAYOUT_POINTER)) {
+		LOG_ERROR("Dictionary filtering needs the pointer trie.");
+		return false;
+	}
+	if (dirty) { refreshLayouts(); }
+
+	// collect first, erasing prunes the nodes getWord walks
+	TrieInfo before = dictionary.getTrieInfo();
+	vector<string> dropped;
+	uint32_t reasons[DICE_LETTERS + 1] = {};
+	string word;
+	for (uint32_t id = 0; dictionary.getWord(id, word); id++) {
+		DiceFit fit = dice.fit(word);
+		if (fit != DICE_FIT) {
+			reasons[fit]++;
+			dropped.push_back(word);
+		}
+	}
+	for (size_t w = 0; w < dropped.size(); w++) {
+		dictionary.erase(dropped[w].c_str(), dropped[w].length());
+	}
+	dictionary.assignWordIds();
+	loadPrefixNodes();
+	dirty = true;
+	diceSet = dice;
+
+	TrieInfo after = dictionary.getTrieInfo();
+	LOG_INFO("Dice %08x filter removed %lu of %lu words (%u too long, %u bare Q, %u letters) and %lu of %lu trie nodes.",
+		dice.getKey(), dropped.size(), before.wordCount, reasons[DICE_TOO_LONG], reasons[DICE_BARE_Q],
+		reasons[DICE_LETTERS], before.letterCount - after.letterCount, before.letterCount);
+
+	return dictionary.serialize(trieFile.c_str());
+}
+
+void Boggle::loadFilters() {
+	for (int a = 0; a < 26; a++) {
+		letterCounts[a] = 0;
+		for (int b = 0; b < 26; b++) {
+			bigrams[a][b] = false;
+		}
+	}
+
+	for EACH_I {
+		for EACH_J {
+			int index = charToIndex(board[i][j]);
+			letterCounts[index]++;
+			for (int mi = i - 1; mi <= i + 1; mi++) {
+				for (int mj = j - 1; mj <= j + 1; mj++) {
+					if (inRange(mi) && inRange(mj) && ((mi != i) || (mj != j))) {
+						bigrams[index][charToIndex(board[mi][mj])] = true;
+					}
+				}
+			}
+		}
+	}
+}
+
+void Boggle::loadPrefixNodes() {
+	TrieNode* root = dictionary.getRoot();
+	for (int a = 0; a < 26; a++) {
+		for (int b = 0; b < 26; b++) {
+			TrieNode* first = root->children[a];
+			if ((first != NULL) && (first->children[b] != NULL)) {
+				prefixNodes[a][b] = countNodes(first->children[b]);
+			} else {
+				prefixNodes[a][b] = 0;
+			}
+		}
+	}
+}
+
+bool Boggle::matchPath(const char* word, int len, int i, int j) {
+	if (!isSafe(i, j) || (board[i][j] != *word)) {
+		return false;
+	}
+	// a Q cell covers "QU"
+	int step = (*word == 'Q') ? 2 : 1;
+	if (len == step) {
+		return true;
+	}
+
+	visited[i][j] = true;
+	bool found = false;
+	for (int mi = i - 1; (mi <= i + 1) && !found; mi++) {
+		for (int mj = j - 1; (mj <= j + 1) && !found; mj++) {
+			found = matchPath(word + step, len - step, mi, mj);
+		}
+	}
+	visited[i][j] = false;
+
+	return found;
+}
+
+int Boggle::engineLayout(SolveEngine engine) {
+	switch (engine) {
+		case ENGINE_AUTO: return 0;
+		case ENGINE_COMPACT: return LAYOUT_COMPACT;
+		case ENGINE_LOUDS: return LAYOUT_LOUDS;
+		default: return LAYOUT_POINTER;
+	}
+}
+
+TrieInfo Boggle::getTrieInfo() {
+	if (layouts & LAYOUT_POINTER) {
+		return dictionary.getTrieInfo();
+	}
+
+	TrieInfo info;
+	if (layouts & LAYOUT_COMPACT) {
+		info.letterCount = compact.getNodeCount() - 1;
+		info.wordCount = compact.getWordCount();
+		info.trieSize = compact.getSize();
+	} else {
+		info.letterCount = louds.getNodeCount() - 1;
+		info.wordCount = louds.getWordCount();
+		info.trieSize = louds.getSize();
+	}
+	return info;
+}
+
+uint64_t Boggle::getDictionaryHash() {
+	if (layouts & LAYOUT_POINTER) {
+		return dictionary.getHash();
+	}
+	if (layouts & LAYOUT_COMPACT) {
+		return hashNodes(CompactTrieView(compact), 0);
+	}
+	LoudsTrieView view(louds);
+	return hashNodes(view, view.root());
+}
+
+bool Boggle::getWordId(const string& word, uint32_t& wordId) {
+	if (dirty) { refreshLayouts(); }
+	if (layouts & LAYOUT_COMPACT) {
+		return lookupWord(CompactTrieView(compact), word, wordId);
+	}
+	if (layouts & LAYOUT_LOUDS) {
+		return lookupWord(LoudsTrieView(louds), word, wordId);
+	}
+	return lookupWord(PointerTrieView(dictionary), word, wordId);
+}
+
+bool Boggle::getWord(uint32_t wordId, string& word) {
+	if (dirty) { refreshLayouts(); }
+	if (layouts & LAYOUT_COMPACT) {
+		return compact.getWord(wordId, word);
+	}
+	if (layouts & LAYOUT_LOUDS) {
+		return louds.getWord(wordId, word);
+	}
+	return dictionary.getWord(wordId, word);
+}
+
+void Boggle::getBoard(char* letters) {
+	for EACH_I {
+		for EACH_J {
+			letters[i * 5 + j] = board[i][j];
+		}
+	}
+	letters[BOARD_CELLS] = '\0';
 }
 
 void Boggle::newGame() {
+	newGame(time(NULL));
+}
+
+void Boggle::newGame(unsigned int seed) {
+	rng.seed(seed);
+	loadDice();
 	loadBoard();
 	clearVisited();
 }
@@ -189,9 +748,169 @@ void Boggle::printBoard(std::ostream& stream) {
 	stream << "+---+---+---+---+---+\n";
 }
 
+void Boggle::searchDict(TrieNode* node, char* word, int len) {
+	if (node->isLeaf && (len >= MIN_WORD_LENGTH)) {
+		// every letter and bigram is on the board, check for an actual path
+		bool found = false;
+		for (int i = 0; (i < 5) && !found; i++) {
+			for (int j = 0; (j < 5) && !found; j++) {
+				found = matchPath(word, len, i, j);
+			}
+		}
+		if (found) {
+			FoundWord foundWord = { node->wordId, len };
+			this->found.push_back(foundWord);
+		}
+	}
+
+	// the last cell's letter; a U right after a Q came from the Q cell
+	int prev = (len > 0) ? charToIndex(word[len - 1]) : -1;
+	if ((len > 1) && (word[len - 2] == 'Q') && (word[len - 1] == 'U')) {
+		prev = Q_INDEX;
+	}
+	for (int k = 0; k < 26; k++) {
+		// a Q cell continues straight to the QU node
+		TrieNode* child = (k == Q_INDEX) ? quChild(node) : node->children[k];
+		if ((child == NULL) || (letterCounts[k] == 0)) {
+			continue;
+		}
+		if ((prev >= 0) && !bigrams[prev][k]) {
+			continue;
+		}
+
+		// never use a letter more often than the board has it
+		letterCounts[k]--;
+		word[len] = indexToChar(k);
+		if (k == Q_INDEX) {
+			word[len + 1] = 'U';
+			searchDict(child, word, len + 2);
+		} else {
+			searchDict(child, word, len + 1);
+		}
+		letterCounts[k]++;
+	}
+}
+
+template <class View>
+bool Boggle::searchIterative(const View& view, const SolveOptions& options) {
+	char letters[BOARD_CELLS + 1];
+	BoardWalk<View> walk(view, options.prefetch);
+	FoundWord word;
+
+	getBoard(letters);
+	walk.reset(letters);
+	if (options.bounded()) {
+		int cells[BOARD_CELLS];
+		loadStartOrder(cells);
+		walk.setOrder(cells);
+		walk.setBudget(SOLVE_CHECK_STEPS);
+	}
+
+	while (true) {
+		if (walk.next(word)) {
+			found.push_back(word);
+			if (options.paths != PATHS_NONE) {
+				foundPaths.push_back(WordPath());
+				walk.getPath(word.wordId, foundPaths.back());
+			}
+			continue;
+		}
+		if (walk.done()) {
+			return true;
+		}
+		// paused for the deadline and cancel checks
+		if ((options.cancel != NULL) && options.cancel->load(std::memory_order_relaxed)) {
+			return false;
+		}
+		if (steady_clock::now() >= options.deadline) {
+			return false;
+		}
+		walk.setBudget(SOLVE_CHECK_STEPS);
+	}
+}
+
+void Boggle::loadStartOrder(int* cells) {
+	// Most valuable starting cells first: a cell is worth the trie nodes below
+	// the two-letter prefixes it starts with its neighbors. Blanks count as
+	// their best letter, and a Q cell as the "QU" prefix alone.
+	uint32_t worth[BOARD_CELLS];
+	char letters[BOARD_CELLS + 1];
+	getBoard(letters);
+	for (int c = 0; c < BOARD_CELLS; c++) {
+		uint32_t best = 0;
+		for (int a = 0; a < 26; a++) {
+			if ((letters[c] != BLANK_CELL) && (a != charToIndex(letters[c]))) { continue; }
+			uint32_t sum = 0;
+			if (a == Q_INDEX) {
+				sum = prefixNodes[a][U_INDEX];
+			} else {
+				for (const int* cell = neighbors.cells[c]; *cell >= 0; cell++) {
+					if (letters[*cell] != BLANK_CELL) {
+						sum += prefixNodes[a][charToIndex(letters[*cell])];
+						continue;
+					}
+					uint32_t most = 0;
+					for (int b = 0; b < 26; b++) { most = std::max(most, prefixNodes[a][b]); }
+					sum += most;
+				}
+			}
+			best = std::max(best, sum);
+		}
+		worth[c] = best;
+		cells[c] = c;
+	}
+	std::stable_sort(cells, cells + BOARD_CELLS, [&worth](int a, int b) { return worth[a] > worth[b]; });
+}
+
+bool Boggle::profileLayout(unsigned int boards, unsigned int seed) {
+	if (!(layouts & LAYOUT_POINTER)) {
+		LOG_ERROR("Layout profiling needs the pointer trie.");
+		return false;
+	}
+
+	// compact node indices are breadth-first indices, the trie file's node order
+	CompactTrie scratch;
+	const CompactTrie* trie = &compact;
+	if (!(layouts & LAYOUT_COMPACT)) {
+		if (!scratch.build(dictionary)) { return false; }
+		trie = &scratch;
+	}
+
+	std::vector<uint64_t> visits(trie->getNodeCount(), 0);
+	ProfileTrieView view(*trie, visits.data());
+	SolveOptions options;
+	options.prefetch = false;
+	for (unsigned int b = 0; b < boards; b++) {
+		newGame(seed + b);
+		searchIterative(view, options);
+		found.clear();
+	}
+
+	// hottest first; untouched nodes keep breadth-first order behind them
+	std::vector<uint32_t> order(visits.size());
+	for (uint32_t n = 0; n < order.size(); n++) { order[n] = n; }
+	std::stable_sort(order.begin(), order.end(),
+		[&visits](uint32_t a, uint32_t b) { return visits[a] > visits[b]; });
+
+	uint32_t touched = 0;
+	uint64_t total = 0, hot = 0;
+	for (uint32_t n = 0; n < order.size(); n++) {
+		if (visits[order[n]] > 0) { touched++; }
+		total += visits[order[n]];
+		if (n < LAYOUT_HOT_NODES) { hot += visits[order[n]]; }
+	}
+	LOG_INFO("Layout profile over %u boards: %u of %lu trie nodes read, hottest %u take %.1f%% of reads.",
+		boards, touched, order.size(), LAYOUT_HOT_NODES, (total > 0) ? hot * 100.0 / total : 0.0);
+
+	// persisted in the trie file; nodes are placed in this order on the next load
+	dictionary.setLayout(order);
+	return dictionary.serialize(trieFile.c_str());
+}
+
 void Boggle::searchWord(TrieNode* root, int i, int j, string str) {
 	if ((root->isLeaf == true) && (str.length() >= 4)) {
-		words.push_back(str);
+		FoundWord foundWord = { root->wordId, (int)str.length() };
+		found.push_back(foundWord);
 	}
 
 	if (isSafe(i, j)) {
@@ -210,7 +929,15 @@ void Boggle::searchWord(TrieNode* root, int i, int j, string str) {
 				for (int m = 0; m < 8; m++) {
 					int mi = move[m][0];
 					int mj = move[m][1];
-					if (isSafe(mi, mj) && (board[mi][mj] == ch)) {
+					if (!isSafe(mi, mj)) {
+						continue;
+					}
+					if ((ch == 'Q') && ((board[mi][mj] == 'Q') || (board[mi][mj] == BLANK_CELL))) {
+						// a Q cell, or a blank played as Q, reads "QU"
+						if (quChild(root) != NULL) {
+							searchWord(quChild(root), mi, mj, str + "QU");
+						}
+					} else if ((board[mi][mj] == ch) || (board[mi][mj] == BLANK_CELL)) {
 						searchWord(root->children[k], mi, mj, str + ch);
 					}
 				}
@@ -221,9 +948,306 @@ void Boggle::searchWord(TrieNode* root, int i, int j, string str) {
  	}
 }
 
+SolveEngine Boggle::selectEngine() {
+	if (!(layouts & LAYOUT_POINTER)) {
+		// the cost model needs the dictionary engine's pointer trie
+		return (layouts & LAYOUT_COMPACT) ? ENGINE_COMPACT : ENGINE_LOUDS;
+	}
+	if (blanks > 0) {
+		// blanks branch inside the board engines; the letter filters can't express them
+		return (layouts & LAYOUT_COMPACT) ? ENGINE_COMPACT : ENGINE_ITERATIVE;
+	}
+
+	// The board engines pay per adjacent cell pair, sublinearly in the size of
+	// the subtree below the pair's prefix; the dictionary engine pays once per
+	// node below every prefix whose bigram appears on the board.
+	double boardCost = 0.0, dictCost = 0.0;
+
+	loadFilters();
+	for EACH_I {
+		for EACH_J {
+			int a = charToIndex(board[i][j]);
+			for (int mi = i - 1; mi <= i + 1; mi++) {
+				for (int mj = j - 1; mj <= j + 1; mj++) {
+					if (inRange(mi) && inRange(mj) && ((mi != i) || (mj != j))) {
+						boardCost += sqrt((double)prefixNodes[a][charToIndex(board[mi][mj])]);
+					}
+				}
+			}
+		}
+	}
+	for (int a = 0; a < 26; a++) {
+		for (int b = 0; b < 26; b++) {
+			if (bigrams[a][b]) {
+				dictCost += prefixNodes[a][b];
+			}
+		}
+	}
+
+	if (DICT_COST * dictCost < BOARD_COST * boardCost) {
+		return ENGINE_DICT;
+	}
+	return (layouts & LAYOUT_COMPACT) ? ENGINE_COMPACT : ENGINE_ITERATIVE;
+}
+
+int Boggle::scoreBound() {
+	char letters[BOARD_CELLS + 1];
+	if (dirty) { refreshLayouts(); }
+	getBoard(letters);
+
+	if (layouts & LAYOUT_COMPACT) {
+		CompactTrieView view(compact);
+		ScoreBound<CompactTrieView> bound(view, letters);
+		bound.search(view.root(), 0, 0, 0);
+		return bound.points;
+	}
+	if (layouts & LAYOUT_POINTER) {
+		PointerTrieView view(dictionary);
+		ScoreBound<PointerTrieView> bound(view, letters);
+		bound.search(view.root(), 0, 0, 0);
+		return bound.points;
+	}
+	LoudsTrieView view(louds);
+	ScoreBound<LoudsTrieView> bound(view, letters);
+	bound.search(view.root(), 0, 0, 0);
+	return bound.points;
+}
+
+void Boggle::scoreRound(const vector<vector<string> >& submissions, vector<PlayerScore>& scores) {
+	// solve once; bit k of a player's set is the k-th word found, in ID order
+	SolveOptions options;
+	options.listWords = false;
+	SolveResult result;
+	solve(result, options);
+
+	size_t blocks = (found.size() + 63) / 64;
+	vector<uint64_t> playerWords(submissions.size() * blocks, 0);
+	vector<uint64_t> once(blocks, 0), shared(blocks, 0);
+	scores.assign(submissions.size(), PlayerScore());
+
+	for (size_t p = 0; p < submissions.size(); p++) {
+		uint64_t* words = &playerWords[p * blocks];
+		for (size_t w = 0; w < submissions[p].size(); w++) {
+			const string& word = submissions[p][w];
+			uint32_t wordId;
+			if ((word.length() < MIN_WORD_LENGTH) || !getWordId(word, wordId)) {
+				scores[p].invalid++;
+				continue;
+			}
+			FoundWord key = { wordId, 0 };
+			vector<FoundWord>::const_iterator match = std::lower_bound(found.begin(), found.end(), key);
+			if ((match == found.end()) || (match->wordId != wordId)) {
+				scores[p].invalid++;
+				continue;
+			}
+			size_t k = match - found.begin();
+			words[k / 64] |= 1ull << (k % 64);
+		}
+
+		// words already seen once become shared on their second sighting
+		for (size_t b = 0; b < blocks; b++) {
+			shared[b] |= once[b] & words[b];
+			once[b] |= words[b];
+		}
+	}
+
+	for (size_t p = 0; p < submissions.size(); p++) {
+		const uint64_t* words = &playerWords[p * blocks];
+		for (size_t b = 0; b < blocks; b++) {
+			scores[p].words += __builtin_popcountll(words[b]);
+			for (uint64_t unique = words[b] & ~shared[b]; unique != 0; unique &= unique - 1) {
+				scores[p].unique++;
+				scores[p].points += wordPoints(found[b * 64 + __builtin_ctzll(unique)].len);
+			}
+		}
+	}
+}
+
+bool Boggle::setBoard(const char* letters) {
+	if ((letters == NULL) || (strlen(letters) != BOARD_CELLS)) {
+		return false;
+	}
+	int count = 0;
+	for (int k = 0; k < BOARD_CELLS; k++) {
+		if (letters[k] == BLANK_CELL) {
+			count++;
+		} else if ((letters[k] < 'A') || (letters[k] > 'Z')) {
+			return false;
+		}
+	}
+
+	blanks = count;
+	for EACH_I {
+		for EACH_J {
+			board[i][j] = letters[i * 5 + j];
+		}
+	}
+	clearVisited();
+
+	return true;
+}
+
+void Boggle::solve(SolveResult& result, SolveEngine engine) {
+	SolveOptions options;
+	options.engine = engine;
+	solve(result, options);
+}
+
+void Boggle::solve(SolveResult& result, const SolveOptions& options) {
+	SolveEngine engine = options.engine;
+	if (dirty) { refreshLayouts(); }
+	clearVisited();
+	found.clear();
+	foundPaths.clear();
+
+	if (!(layouts & engineLayout(engine)) || ((engine == ENGINE_DICT) && (blanks > 0))) {
+		// auto, the engine's layout is not loaded, or blanks the dictionary engine can't filter
+		engine = selectEngine();
+	}
+	// a selection that leaves out a dictionary needs the pointer trie's membership bits
+	bool overlay = (layouts & LAYOUT_POINTER) && (dictionary.getDictionaries() & ~options.dictionaries);
+	if (overlay) {
+		engine = ENGINE_ITERATIVE;
+	}
+	bool bounded = options.bounded();
+	bool walk = bounded || (options.paths != PATHS_NONE);
+	if (walk && (engine != ENGINE_COMPACT) && (engine != ENGINE_ITERATIVE) && (engine != ENGINE_LOUDS)) {
+		// only the walk engines can pause for the deadline checks or keep the path to a word
+		engine = (layouts & LAYOUT_COMPACT) ? ENGINE_COMPACT : (layouts & LAYOUT_POINTER) ? ENGINE_ITERATIVE : ENGINE_LOUDS;
+	}
+	result.engine = engine;
+	result.complete = true;
+
+	if (engine == ENGINE_DICT) {
+		// dictionary order is word ID order, no sort needed
+		char word[2 * BOARD_CELLS + 1];	// every cell could be a Qu
+		loadFilters();
+		searchDict(dictionary.getRoot(), word, 0);
+	} else if (engine == ENGINE_LOUDS) {
+		result.complete = searchIterative(LoudsTrieView(louds), options);
+		std::sort(found.begin(), found.end());
+		found.erase(std::unique(found.begin(), found.end()), found.end());
+	} else if (engine == ENGINE_COMPACT) {
+		result.complete = searchIterative(CompactTrieView(compact), options);
+		std::sort(found.begin(), found.end());
+		found.erase(std::unique(found.begin(), found.end()), found.end());
+	} else if (overlay) {
+		result.complete = searchIterative(OverlayTrieView(dictionary, options.dictionaries), options);
+		std::sort(found.begin(), found.end());
+		found.erase(std::unique(found.begin(), found.end()), found.end());
+	} else if (engine == ENGINE_ITERATIVE) {
+		result.complete = searchIterative(PointerTrieView(dictionary), options);
+		std::sort(found.begin(), found.end());
+		found.erase(std::unique(found.begin(), found.end()), found.end());
+	} else {
+		TrieNode* child = dictionary.getRoot();
+		string str = "";
+
+		for EACH_I {
+			for EACH_J {
+				for (int index = 0; index < 26; index++) {
+					if ((board[i][j] != BLANK_CELL) && (index != charToIndex(board[i][j]))) { continue; }
+					if (index == Q_INDEX) {
+						if (quChild(child) != NULL) {
+							searchWord(quChild(child), i, j, "QU");
+						}
+					} else if (child->children[index]) {
+						char ch = indexToChar(index);
+						str = str + ch;
+						searchWord(child->children[index], i, j, str);
+						str = "";
+					}
+				}
+			}
+		}
+
+		std::sort(found.begin(), found.end());
+		found.erase(std::unique(found.begin(), found.end()), found.end());
+	}
+
+	solveCount.fetch_add(1, std::memory_order_relaxed);
+	if (bounded) {
+		boundedCount.fetch_add(1, std::memory_order_relaxed);
+		if (!result.complete) {
+			bool cancelled = (options.cancel != NULL) && options.cancel->load(std::memory_order_relaxed);
+			(cancelled ? cancelCount : timeoutCount).fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (options.paths != PATHS_NONE) {
+		// walk order within a word, so the first path kept is the first found
+		std::stable_sort(foundPaths.begin(), foundPaths.end());
+		if (options.paths == PATHS_FIRST) {
+			foundPaths.erase(std::unique(foundPaths.begin(), foundPaths.end()), foundPaths.end());
+		}
+	}
+
+	result.wordIds.clear();
+	result.words.clear();
+	result.paths.clear();
+	result.points = 0;
+	for (int i = 0; i < WORD_COUNTS; i++) {
+		result.wordCounts[i] = 0;
+	}
+
+	size_t path = 0;
+	for (vector<FoundWord>::const_iterator iterator = found.begin(); iterator != found.end(); iterator++) {
+		// the paths spelling this word, if any were kept
+		size_t paths = path;
+		while ((paths < foundPaths.size()) && (foundPaths[paths].wordId == iterator->wordId)) {
+			paths++;
+		}
+		int len = iterator->len;
+		if (len - MIN_WORD_LENGTH >= WORD_COUNTS) {
+			LOG_INFO("Word %u is too long for board", iterator->wordId);
+			path = paths;
+			continue;
+		}
+		result.paths.insert(result.paths.end(), foundPaths.begin() + path, foundPaths.begin() + paths);
+		path = paths;
+		result.wordIds.push_back(iterator->wordId);
+		if (options.listWords) {
+			result.words.push_back(string());
+			getWord(iterator->wordId, result.words.back());
+		}
+		result.wordCounts[len - MIN_WORD_LENGTH]++;
+		result.points += wordPoints(len);
+	}
+}
+
 void Boggle::solveGame(std::ostream& stream) {
+	ResultWriter writer(stream, FORMAT_TEXT);
 	newGame();
-	printBoard(stream);
-	findWords();
-	printBoard(stream);
+	solveGame(writer);
+}
+
+void Boggle::solveGame(ResultWriter& writer, SolveOptions options) {
+	SolveResult result;
+	char letters[BOARD_CELLS + 1];
+
+	options.listWords = writer.needsWords();
+	solve(result, options);
+	getBoard(letters);
+	writer.write(letters, result);
+}
+
+SolveMetrics Boggle::getMetrics() {
+	SolveMetrics metrics;
+	metrics.solves = solveCount.load(std::memory_order_relaxed);
+	metrics.bounded = boundedCount.load(std::memory_order_relaxed);
+	metrics.timeouts = timeoutCount.load(std::memory_order_relaxed);
+	metrics.cancels = cancelCount.load(std::memory_order_relaxed);
+
+	return metrics;
+}
+
+int Boggle::wordPoints(int len) {
+	switch (len) {
+		case 0: case 1: case 2: case 3: return 0;
+		case 4: return 1;
+		case 5: return 2;
+		case 6: return 3;
+		case 7: return 5;
+		default: return 11;
+	}
 }
@@ -0,0 +1,149 @@
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include "Boggle.h"
+#include "BoggleApi.h"
+#include "Logger.h"
+
+struct BoggleSolver {
+	Boggle boggle;
+	SolveResult result;		// reused, so its vectors keep their capacity
+
+	explicit BoggleSolver(Boggle* dictionarySource) : boggle(dictionarySource) { }
+};
+
+struct boggle_dict {
+	Boggle* source;		// holds the dictionary; never solves
+	std::mutex lock;
+	std::vector<BoggleSolver*> solvers;
+	std::vector<BoggleSolver*> idle;	// capacity for every solver, so release() never allocates
+
+	BoggleSolver* acquire();
+	void release(BoggleSolver* solver);
+};
+
+BoggleSolver* boggle_dict::acquire() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!idle.empty()) {
+			BoggleSolver* solver = idle.back();
+			idle.pop_back();
+			return solver;
+		}
+	}
+
+	// one more concurrent caller than ever before
+	BoggleSolver* solver = new BoggleSolver(source);
+	std::lock_guard<std::mutex> guard(lock);
+	solvers.push_back(solver);
+	idle.reserve(solvers.size());
+
+	return solver;
+}
+
+void boggle_dict::release(BoggleSolver* solver) {
+	std::lock_guard<std::mutex> guard(lock);
+	idle.push_back(solver);
+}
+
+static bool fileExists(const char* fileName) {
+	std::ifstream file(fileName);
+	return file.is_open();
+}
+
+static void quietConsole() {
+	// the host owns stdout and stderr; boggle_log() is the only way out
+	Logger::Instance()->setConsole(NULL, NULL);
+}
+
+boggle_dict* boggle_open(const char* wordFileName, const char* trieFileName) {
+	quietConsole();
+	if (trieFileName == NULL) {
+		return NULL;
+	}
+
+	Boggle* source;
+	if (wordFileName == NULL) {
+		source = new Boggle(trieFileName);
+	} else if (fileExists(wordFileName) || fileExists(trieFileName)) {
+		// the solvers only read the compact layout
+		source = new Boggle(wordFileName, trieFileName, LAYOUT_COMPACT);
+	} else {
+		LOG_ERROR("Unable to open dictionary file '%s' or trie file '%s'.", wordFileName, trieFileName);
+		return NULL;
+	}
+	if (!(source->getLayouts() & LAYOUT_COMPACT)) {
+		delete source;
+		return NULL;
+	}
+
+	boggle_dict* dict = new boggle_dict();
+	dict->source = source;
+
+	return dict;
+}
+
+int64_t boggle_solve(boggle_dict* dict, const char* boards, size_t count, int32_t* scores, uint32_t* wordIds,
+	size_t wordCapacity, uint64_t* offsets) {
+	if ((dict == NULL) || (boards == NULL) || (scores == NULL) || ((wordIds == NULL) != (offsets == NULL))) {
+		return BOGGLE_ERROR_ARGUMENT;
+	}
+
+	BoggleSolver* solver = dict->acquire();
+	SolveOptions options;
+	options.listWords = false;
+	char letters[BOARD_CELLS + 1];
+	letters[BOARD_CELLS] = '\0';
+	size_t used = 0;
+	if (offsets != NULL) {
+		offsets[0] = 0;
+	}
+
+	size_t b;
+	for (b = 0; b < count; b++) {
+		std::memcpy(letters, &boards[b * BOARD_CELLS], BOARD_CELLS);
+		int32_t points = -1;
+		size_t words = 0;
+		if (solver->boggle.setBoard(letters)) {
+			solver->boggle.solve(solver->result, options);
+			points = solver->result.points;
+			words = solver->result.wordIds.size();
+		}
+		if (wordIds != NULL) {
+			if (words > wordCapacity - used) {
+				break;
+			}
+			if (words > 0) {
+				std::memcpy(&wordIds[used], solver->result.wordIds.data(), words * sizeof(uint32_t));
+			}
+			used += words;
+			offsets[b + 1] = used;
+		}
+		scores[b] = points;
+	}
+
+	dict->release(solver);
+
+	return b;
+}
+
+void boggle_close(boggle_dict* dict) {
+	if (dict == NULL) {
+		return;
+	}
+	for (size_t s = 0; s < dict->solvers.size(); s++) {
+		delete dict->solvers[s];
+	}
+	delete dict->source;
+	delete dict;
+}
+
+void boggle_log(const char* logFileName) {
+	quietConsole();
+	Logger::Instance()->closeLogFile();
+	if (logFileName != NULL) {
+		Logger::Instance()->openLogFile(logFileName, false);
+	}
+}
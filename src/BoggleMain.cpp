@@ -1,21 +1,321 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "Boggle.h"
 #include "Logger.h"
+#include "NodePool.h"
+#include "ResultWriter.h"
+#include "Simulation.h"
+#include "Supervisor.h"
 
 #define MAIN_LOG "BoggleMain.log"
 
+static void usage(const char* name) {
+	fprintf(stderr, "Usage: %s [--games N] [--seed S] [--format text|json|binary] [--scores-only] [--output FILE]\n"
+		"       [--pages default|transparent|explicit] [--engine auto|board|iterative|dict|compact|louds] [--no-prefetch]\n"
+		"       [--compile-trie FILE] [--layout pointer,compact,louds] [--profile-layout BOARDS]\n"
+		"       [--simulate BOARDS [--threads N] [--checkpoint FILE]] [--workers N]\n"
+		"       [--add-word WORD]... [--remove-word WORD]... [--overlay FILE]... [--dicts MASK]\n"
+		"       [--complete PREFIX [--top K] [--rank points|length|WEIGHTFILE]]\n"
+		"       [--pattern PATTERN] [--board LETTERS] [--dice FILE] [--deadline-us N] [--min-score N]\n"
+		"       [--paths first|all]\n", name);
+}
+
 int main(int argc, char** argv) {
+	OutputFormat format = FORMAT_TEXT;
+	bool listWords = true;
+	bool seeded = false;
+	unsigned int seed = 0;
+	long games = 1;
+	const char* outputFileName = NULL;
+	const char* compactFileName = NULL;
+	unsigned int profileBoards = 0;
+	uint64_t simulateBoards = 0;
+	unsigned int threads = std::thread::hardware_concurrency();
+	const char* checkpointFileName = NULL;
+	std::vector<std::pair<bool, string> > edits;
+	std::vector<const char*> overlays;
+	const char* completePrefix = NULL;
+	size_t completeCount = 10;
+	CompletionRank rank = RANK_POINTS;
+	const char* weightFileName = NULL;
+	const char* pattern = NULL;
+	const char* boardLetters = NULL;
+	const char* diceFileName = NULL;
+	long deadlineUs = 0;
+	int minScore = 0;
+	unsigned int workerCount = 0;
+	SolveOptions options;
+	int layouts = LAYOUT_DEFAULT;
+
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--games") == 0) && (i + 1 < argc)) {
+			games = atol(argv[++i]);
+		} else if ((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) {
+			seed = strtoul(argv[++i], NULL, 10);
+			seeded = true;
+		} else if ((strcmp(argv[i], "--format") == 0) && (i + 1 < argc)) {
+			i++;
+			if (strcmp(argv[i], "text") == 0) { format = FORMAT_TEXT; }
+			else if (strcmp(argv[i], "json") == 0) { format = FORMAT_JSON; }
+			else if (strcmp(argv[i], "binary") == 0) { format = FORMAT_BINARY; }
+			else { usage(argv[0]); return 1; }
+		} else if (strcmp(argv[i], "--scores-only") == 0) {
+			listWords = false;
+		} else if ((strcmp(argv[i], "--output") == 0) && (i + 1 < argc)) {
+			outputFileName = argv[++i];
+		} else if ((strcmp(argv[i], "--pages") == 0) && (i + 1 < argc)) {
+			PageMode mode;
+			if (!parsePageMode(argv[++i], mode)) { usage(argv[0]); return 1; }
+			NodePool::Instance()->setPageMode(mode);
+		} else if ((strcmp(argv[i], "--engine") == 0) && (i + 1 < argc)) {
+			i++;
+			if (strcmp(argv[i], "auto") == 0) { options.engine = ENGINE_AUTO; }
+			else if (strcmp(argv[i], "board") == 0) { options.engine = ENGINE_BOARD; }
+			else if (strcmp(argv[i], "iterative") == 0) { options.engine = ENGINE_ITERATIVE; }
+			else if (strcmp(argv[i], "dict") == 0) { options.engine = ENGINE_DICT; }
+			else if (strcmp(argv[i], "compact") == 0) { options.engine = ENGINE_COMPACT; }
+			else if (strcmp(argv[i], "louds") == 0) { options.engine = ENGINE_LOUDS; }
+			else { usage(argv[0]); return 1; }
+		} else if ((strcmp(argv[i], "--layout") == 0) && (i + 1 < argc)) {
+			const char* layout = argv[++i];
+			layouts = 0;
+			if (strstr(layout, "pointer") != NULL) { layouts |= LAYOUT_POINTER; }
+			if (strstr(layout, "compact") != NULL) { layouts |= LAYOUT_COMPACT; }
+			if (strstr(layout, "louds") != NULL) { layouts |= LAYOUT_LOUDS; }
+			if (layouts == 0) { usage(argv[0]); return 1; }
+		} else if ((strcmp(argv[i], "--compile-trie") == 0) && (i + 1 < argc)) {
+			compactFileName = argv[++i];
+		} else if ((strcmp(argv[i], "--profile-layout") == 0) && (i + 1 < argc)) {
+			profileBoards = strtoul(argv[++i], NULL, 10);
+		} else if ((strcmp(argv[i], "--simulate") == 0) && (i + 1 < argc)) {
+			simulateBoards = strtoull(argv[++i], NULL, 10);
+		} else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc)) {
+			threads = strtoul(argv[++i], NULL, 10);
+		} else if ((strcmp(argv[i], "--workers") == 0) && (i + 1 < argc)) {
+			workerCount = strtoul(argv[++i], NULL, 10);
+		} else if ((strcmp(argv[i], "--checkpoint") == 0) && (i + 1 < argc)) {
+			checkpointFileName = argv[++i];
+		} else if ((strcmp(argv[i], "--add-word") == 0) && (i + 1 < argc)) {
+			edits.push_back(std::make_pair(true, string(argv[++i])));
+		} else if ((strcmp(argv[i], "--remove-word") == 0) && (i + 1 < argc)) {
+			edits.push_back(std::make_pair(false, string(argv[++i])));
+		} else if ((strcmp(argv[i], "--overlay") == 0) && (i + 1 < argc)) {
+			overlays.push_back(argv[++i]);
+		} else if ((strcmp(argv[i], "--dicts") == 0) && (i + 1 < argc)) {
+			options.dictionaries = strtoul(argv[++i], NULL, 0);
+			if (options.dictionaries == 0) { usage(argv[0]); return 1; }
+		} else if ((strcmp(argv[i], "--complete") == 0) && (i + 1 < argc)) {
+			completePrefix = argv[++i];
+		} else if ((strcmp(argv[i], "--top") == 0) && (i + 1 < argc)) {
+			completeCount = strtoul(argv[++i], NULL, 10);
+		} else if ((strcmp(argv[i], "--rank") == 0) && (i + 1 < argc)) {
+			i++;
+			if (strcmp(argv[i], "points") == 0) { rank = RANK_POINTS; }
+			else if (strcmp(argv[i], "length") == 0) { rank = RANK_LENGTH; }
+			else { rank = RANK_WEIGHT; weightFileName = argv[i]; }
+		} else if ((strcmp(argv[i], "--pattern") == 0) && (i + 1 < argc)) {
+			pattern = argv[++i];
+		} else if ((strcmp(argv[i], "--board") == 0) && (i + 1 < argc)) {
+			boardLetters = argv[++i];
+		} else if ((strcmp(argv[i], "--dice") == 0) && (i + 1 < argc)) {
+			diceFileName = argv[++i];
+		} else if ((strcmp(argv[i], "--deadline-us") == 0) && (i + 1 < argc)) {
+			deadlineUs = atol(argv[++i]);
+		} else if ((strcmp(argv[i], "--min-score") == 0) && (i + 1 < argc)) {
+			minScore = atoi(argv[++i]);
+		} else if ((strcmp(argv[i], "--paths") == 0) && (i + 1 < argc)) {
+			i++;
+			if (strcmp(argv[i], "first") == 0) { options.paths = PATHS_FIRST; }
+			else if (strcmp(argv[i], "all") == 0) { options.paths = PATHS_ALL; }
+			else { usage(argv[0]); return 1; }
+		} else if (strcmp(argv[i], "--no-prefetch") == 0) {
+			options.prefetch = false;
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
 	Logger::Instance()->openLogFile(MAIN_LOG, true);
+	if (outputFileName == NULL) {
+		// stdout carries the results, so log lines go to stderr with the errors
+		Logger::Instance()->setConsole(stderr, stderr);
+	}
 
-	Boggle boggle = Boggle();
+	// custom dice get their own filtered trie file, compiled on first use
+	DiceSet dice;
+	if ((diceFileName != NULL) && !dice.load(diceFileName)) {
+		return 1;
+	}
+	std::unique_ptr<Boggle> solver((diceFileName != NULL) ? new Boggle(dice, layouts) : new Boggle(layouts));
+	Boggle& boggle = *solver;
 	TrieInfo info = boggle.getTrieInfo();
 	LOG_INFO("Boggle dictionary word count = %lu", info.wordCount);
 	LOG_INFO("Boggle dictionary letter count = %lu", info.letterCount);
 	LOG_INFO("Boggle dictionary trie size (bytes) = %lu B", info.trieSize);
 
-	LOG_INFO("Solving game");
-	boggle.solveGame(std::cout);
+	// overlay k is dictionary k, the dictionary file being dictionary 0
+	for (size_t o = 0; o < overlays.size(); o++) {
+		if (!boggle.loadOverlay(overlays[o], o + 1)) {
+			Logger::Instance()->closeLogFile();
+			return 1;
+		}
+	}
+
+	if (!edits.empty()) {
+		// journaled, so the trie file is not rebuilt
+		bool ret = true;
+		for (size_t e = 0; e < edits.size(); e++) {
+			bool edited = edits[e].first ? boggle.addWord(edits[e].second) : boggle.removeWord(edits[e].second);
+			if (!edited) {
+				LOG_ERROR("Unable to %s word '%s'", edits[e].first ? "add" : "remove", edits[e].second.c_str());
+				ret = false;
+			}
+		}
+		Logger::Instance()->closeLogFile();
+		return ret ? 0 : 1;
+	}
+
+	if (completePrefix != NULL) {
+		std::vector<string> words;
+		bool ret = boggle.loadCompletions(rank, weightFileName);
+		if (ret) {
+			uint32_t total = boggle.complete(completePrefix, completeCount, words);
+			std::cout << total << " words start with " << completePrefix << std::endl;
+			for (size_t w = 0; w < words.size(); w++) {
+				std::cout << words[w] << std::endl;
+			}
+		}
+		Logger::Instance()->closeLogFile();
+		return ret ? 0 : 1;
+	}
+
+	if (pattern != NULL) {
+		uint64_t matches = 0;
+		bool ret = boggle.matchPattern(pattern, [&matches](const string& word, uint32_t) {
+			std::cout << word << '\n';
+			matches++;
+			return true;
+		});
+		LOG_INFO("%lu words match '%s'", matches, pattern);
+		Logger::Instance()->closeLogFile();
+		return ret ? 0 : 1;
+	}
+
+	if (profileBoards > 0) {
+		// seeded corpus decides the trie node placement used from the next load on
+		bool ret = boggle.profileLayout(profileBoards, seed);
+		Logger::Instance()->closeLogFile();
+		return ret ? 0 : 1;
+	}
+
+	if (compactFileName != NULL) {
+		// build step for EMBEDDED_DICT binaries
+		bool ret = boggle.saveCompact(compactFileName);
+		Logger::Instance()->closeLogFile();
+		return ret ? 0 : 1;
+	}
+
+	std::ofstream outputFile;
+	if (outputFileName != NULL) {
+		outputFile.open(outputFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outputFile.is_open()) {
+			LOG_ERROR("Unable to open output file '%s'", outputFileName);
+			return 1;
+		}
+	}
+
+	if (simulateBoards > 0) {
+		LOG_INFO("Simulating %lu boards from seed %u on %u threads", simulateBoards, seed, threads);
+		BoardStats stats;
+		Simulation simulation(boggle, threads);
+		bool ret = simulation.run(simulateBoards, seed, checkpointFileName, stats);
+		if (ret) {
+			stats.report((outputFileName != NULL) ? outputFile : std::cout, boggle);
+		}
+		Logger::Instance()->closeLogFile();
+		return ret ? 0 : 1;
+	}
+
+	if ((workerCount > 0) && (boardLetters == NULL)) {
+		// worker processes share this process's dictionary copy-on-write
+		if (!seeded) {
+			seed = std::random_device()();
+		}
+		LOG_INFO("Solving %ld game%s from seed %u on %u worker processes", games, (games == 1) ? "" : "s", seed,
+			workerCount);
+		if (options.paths != PATHS_NONE) {
+			LOG_INFO("Word paths are not reported by worker processes");
+		}
+		bool ret;
+		{
+			ResultWriter writer((outputFileName != NULL) ? outputFile : std::cout, format, listWords);
+			Supervisor supervisor(boggle, workerCount);
+			ret = supervisor.run(games, seed, writer, options);
+		}
+		Logger::Instance()->closeLogFile();
+		return ret ? 0 : 1;
+	}
+
+	LOG_INFO("Solving %ld game%s", games, (games == 1) ? "" : "s");
+	long rejected = 0, below = 0;
+	{
+		ResultWriter writer((outputFileName != NULL) ? outputFile : std::cout, format, listWords);
+		for (long game = 0; game < games; game++) {
+			if (boardLetters != NULL) {
+				// BLANK_CELL marks a blank die
+				if (!boggle.setBoard(boardLetters)) {
+					LOG_ERROR("Board must be %d letters A-Z or '%c'", BOARD_CELLS, BLANK_CELL);
+					return 1;
+				}
+			} else if (seeded) {
+				boggle.newGame(seed + game);
+			} else {
+				boggle.newGame();
+			}
+			if (deadlineUs > 0) {
+				// per board, partial results past it
+				options.deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(deadlineUs);
+			}
+			if (minScore > 0) {
+				// only boards the upper bound can't rule out get solved, and only
+				// those that really make the score are written
+				if (boggle.scoreBound() < minScore) {
+					rejected++;
+					continue;
+				}
+				SolveResult result;
+				char letters[BOARD_CELLS + 1];
+				options.listWords = writer.needsWords();
+				boggle.solve(result, options);
+				if (result.points < minScore) {
+					below++;
+					continue;
+				}
+				boggle.getBoard(letters);
+				writer.write(letters, result);
+				continue;
+			}
+			boggle.solveGame(writer, options);
+		}
+	}
+	if (minScore > 0) {
+		LOG_INFO("%ld of %ld boards scored %d or more: %ld rejected by the score bound, %ld solved and below it",
+			games - rejected - below, games, minScore, rejected, below);
+	}
+	if (deadlineUs > 0) {
+		SolveMetrics metrics = boggle.getMetrics();
+		LOG_INFO("%lu of %lu bounded solves timed out", metrics.timeouts, metrics.bounded);
+	}
 
 	Logger::Instance()->closeLogFile();
 }
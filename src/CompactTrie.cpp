@@ -0,0 +1,306 @@
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "CompactTrie.h"
+#include "Logger.h"
+
+using std::ios;
+
+CompactTrie::CompactTrie() {
+	nodes = NULL;
+	nodeCount = 0;
+	wordCount = 0;
+	embedded = false;
+	owned = NULL;
+	ownedSize = 0;
+	mapped = NULL;
+	mappedSize = 0;
+}
+
+CompactTrie::~CompactTrie() {
+	clear();
+}
+
+void CompactTrie::clear() {
+	freePages(owned, ownedSize);
+	owned = NULL;
+	ownedSize = 0;
+	if (mapped != NULL) {
+		munmap(mapped, mappedSize);
+	}
+	mapped = NULL;
+	mappedSize = 0;
+	nodes = NULL;
+	nodeCount = 0;
+	wordCount = 0;
+	embedded = false;
+}
+
+bool CompactTrie::allocate(uint32_t count) {
+	clear();
+
+	// compact storage follows the trie page mode
+	ownedSize = count * sizeof(CompactTrieNode);
+	PageMode granted;
+	owned = (CompactTrieNode*)allocPages(ownedSize, NodePool::Instance()->getPageMode(), granted);
+	if (owned == NULL) {
+		LOG_ERROR("Unable to allocate %lu B for compact trie", ownedSize);
+		ownedSize = 0;
+		return false;
+	}
+	nodes = owned;
+	nodeCount = count;
+
+	return true;
+}
+
+bool CompactTrie::build(Trie& trie) {
+	// breadth-first, so every node's children end up contiguous
+	std::vector<TrieNode*> queue;
+	queue.push_back(trie.getRoot());
+	for (size_t head = 0; head < queue.size(); head++) {
+		TrieNode* node = queue[head];
+		for (int i = 0; i < 26; i++) {
+			if (node->children[i] != NULL) {
+				queue.push_back(node->children[i]);
+			}
+		}
+	}
+
+	if (!allocate(queue.size())) {
+		return false;
+	}
+
+	uint32_t nextChild = 1;
+	for (size_t n = 0; n < queue.size(); n++) {
+		TrieNode* node = queue[n];
+		CompactTrieNode& compact = owned[n];
+		compact.mask = node->isLeaf ? COMPACT_LEAF : 0;
+		compact.firstChild = nextChild;
+		for (int i = 0; i < 26; i++) {
+			if (node->children[i] != NULL) {
+				compact.mask |= 1u << i;
+				nextChild++;
+			}
+		}
+		if (!(compact.mask & COMPACT_CHILDREN)) {
+			compact.firstChild = 0;
+		}
+	}
+	wordCount = assignWordIds(0, 0);
+
+	return true;
+}
+
+uint32_t CompactTrie::assignWordIds(uint32_t node, uint32_t nextId) {
+	// same numbering as Trie::assignWordIds
+	owned[node].wordId = nextId;
+	if (owned[node].mask & COMPACT_LEAF) { nextId++; }
+
+	uint32_t mask = owned[node].mask & COMPACT_CHILDREN;
+	for (uint32_t child = owned[node].firstChild; mask != 0; mask &= mask - 1, child++) {
+		nextId = assignWordIds(child, nextId);
+	}
+
+	return nextId;
+}
+
+bool CompactTrie::attach(const void* data, size_t size) {
+	clear();
+
+	CompactTrieHeader header;
+	if (size < sizeof(header)) {
+		LOG_INFO("Compact trie is too small for its header.");
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic != COMPACT_MAGIC) {
+		LOG_INFO("Compact trie has bad magic 0x%08x.", header.magic);
+		return false;
+	}
+	if (size < sizeof(header) + header.nodeCount * sizeof(CompactTrieNode)) {
+		LOG_INFO("Compact trie corrupt: %u nodes do not fit in %lu B.", header.nodeCount, size);
+		return false;
+	}
+
+	// read the nodes in place
+	nodes = (const CompactTrieNode*)((const char*)data + sizeof(header));
+	nodeCount = header.nodeCount;
+	wordCount = header.wordCount;
+	if (!validate()) {
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool CompactTrie::validate() const {
+	// Once per attach or load, so the solvers can index without checks: every
+	// child range inside the array and after its parent, as breadth-first order
+	// puts it, which also rules out cycles; every leaf's word ID in range.
+	if (nodeCount == 0) {
+		LOG_INFO("Compact trie corrupt: no root node.");
+		return false;
+	}
+	for (uint32_t n = 0; n < nodeCount; n++) {
+		const CompactTrieNode& node = nodes[n];
+		uint32_t children = __builtin_popcount(node.mask & COMPACT_CHILDREN);
+		if (node.mask & ~(COMPACT_LEAF | COMPACT_CHILDREN)) {
+			LOG_INFO("Compact trie corrupt: node %u has mask 0x%08x.", n, node.mask);
+			return false;
+		}
+		if ((children > 0) && ((node.firstChild <= n) || ((uint64_t)node.firstChild + children > nodeCount))) {
+			LOG_INFO("Compact trie corrupt: node %u has %u children from %u of %u nodes.", n, children,
+				node.firstChild, nodeCount);
+			return false;
+		}
+		if ((node.mask & COMPACT_LEAF) && (node.wordId >= wordCount)) {
+			LOG_INFO("Compact trie corrupt: node %u has word ID %u of %u words.", n, node.wordId, wordCount);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CompactTrie::attachEmbedded() {
+	const void* data;
+	size_t size;
+	if (!getEmbeddedDict(data, size) || !attach(data, size)) {
+		return false;
+	}
+	embedded = true;
+
+	return true;
+}
+
+void CompactTrie::share(const CompactTrie& trie) {
+	// read another trie's nodes in place; 'trie' must outlive this one
+	clear();
+	nodes = trie.nodes;
+	nodeCount = trie.nodeCount;
+	wordCount = trie.wordCount;
+	embedded = trie.embedded;
+}
+
+bool CompactTrie::load(const char* fileName) {
+	LOG_INFO("Loading compact trie file '%s'.", fileName);
+	ifstream file;
+	file.open(fileName, ios::in | ios::binary);
+	if (!file.is_open()) {
+		LOG_INFO("Unable to open compact trie file.");
+		return false;
+	}
+
+	CompactTrieHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || (header.magic != COMPACT_MAGIC)) {
+		LOG_INFO("Compact trie file has a bad header.");
+		return false;
+	}
+	if (!allocate(header.nodeCount)) {
+		return false;
+	}
+	file.read((char*)owned, ownedSize);
+	if (!file) {
+		LOG_INFO("Compact trie corrupt: file is shorter than node list.");
+		clear();
+		return false;
+	}
+	wordCount = header.wordCount;
+	if (!validate()) {
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool CompactTrie::map(const char* fileName) {
+	// read-only and shared, so every process mapping the file shares its pages
+	LOG_INFO("Mapping compact trie file '%s'.", fileName);
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		LOG_INFO("Unable to open compact trie file.");
+		return false;
+	}
+	struct stat info;
+	if ((fstat(fd, &info) < 0) || (info.st_size == 0)) {
+		LOG_INFO("Unable to size compact trie file.");
+		close(fd);
+		return false;
+	}
+	void* data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		LOG_INFO("Unable to map compact trie file.");
+		return false;
+	}
+	if (!attach(data, info.st_size)) {
+		munmap(data, info.st_size);
+		return false;
+	}
+	mapped = data;
+	mappedSize = info.st_size;
+
+	return true;
+}
+
+bool CompactTrie::save(const char* fileName) {
+	LOG_INFO("Saving compact trie file '%s'.", fileName);
+	ofstream file;
+	file.open(fileName, ios::out | ios::binary | ios::trunc);
+	if (!file.is_open()) {
+		LOG_INFO("Unable to open compact trie file for writing.");
+		return false;
+	}
+
+	CompactTrieHeader header;
+	header.magic = COMPACT_MAGIC;
+	header.nodeCount = nodeCount;
+	header.wordCount = wordCount;
+	header.reserved = 0;
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)nodes, getSize());
+	file.close();
+
+	return !file.fail();
+}
+
+bool CompactTrie::getWord(uint32_t wordId, string& word) const {
+	word.clear();
+	if (nodeCount == 0) {
+		return false;
+	}
+
+	const CompactTrieNode* node = &nodes[0];
+	while (!((node->mask & COMPACT_LEAF) && (node->wordId == wordId))) {
+		// descend into the last child whose subtree starts at or before wordId
+		const CompactTrieNode* next = NULL;
+		int index = 0;
+		uint32_t child = node->firstChild;
+		for (int i = 0; i < 26; i++) {
+			if (node->mask & (1u << i)) {
+				if (nodes[child].wordId <= wordId) {
+					next = &nodes[child];
+					index = i;
+				}
+				child++;
+			}
+		}
+		if (next == NULL) {
+			return false;
+		}
+
+		word += indexToChar(index);
+		node = next;
+	}
+
+	return true;
+}
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <queue>
+
+#include "Boggle.h"
+#include "Completer.h"
+#include "Logger.h"
+
+// a word, or a node standing in for the best word of its subtree
+struct CompletionEntry {
+	uint32_t weight;
+	uint32_t wordId;	// the word, or a lower bound on the subtree's word IDs
+	uint32_t node;
+	bool isWord;
+
+	// priority_queue pops the largest: higher weight, then lower ID, words first
+	bool operator<(const CompletionEntry& entry) const {
+		if (weight != entry.weight) { return weight < entry.weight; }
+		if (wordId != entry.wordId) { return wordId > entry.wordId; }
+		return !isWord && entry.isWord;
+	}
+};
+
+void Completer::clear() {
+	trie = NULL;
+	weights.clear();
+	bestWeights.clear();
+	subtreeWords.clear();
+	cacheIndex.clear();
+	cache.clear();
+}
+
+bool Completer::build(const CompactTrie& trie, CompletionRank rank, const char* weightFileName) {
+	clear();
+	const CompactTrieNode* nodes = trie.getNodes();
+	uint32_t nodeCount = trie.getNodeCount();
+	if (nodeCount == 0) {
+		return false;
+	}
+	this->trie = &trie;
+	this->rank = rank;
+
+	// leaf weights; nodes are breadth-first, so parents come before children
+	weights.assign(nodeCount, 0);
+	if (rank == RANK_WEIGHT) {
+		if (!loadWeights(weightFileName)) {
+			clear();
+			return false;
+		}
+	} else {
+		std::vector<uint8_t> depths(nodeCount, 0);
+		for (uint32_t n = 0; n < nodeCount; n++) {
+			uint32_t children = __builtin_popcount(nodes[n].mask & COMPACT_CHILDREN);
+			for (uint32_t c = 0; c < children; c++) {
+				depths[nodes[n].firstChild + c] = depths[n] + 1;
+			}
+			if (nodes[n].mask & COMPACT_LEAF) {
+				int len = depths[n];
+				weights[n] = (rank == RANK_LENGTH) ? len : Boggle::wordPoints(len) * 32 + len;
+			}
+		}
+	}
+
+	// subtree totals, children before parents
+	bestWeights.assign(nodeCount, 0);
+	subtreeWords.assign(nodeCount, 0);
+	for (uint32_t n = nodeCount; n-- > 0;) {
+		if (nodes[n].mask & COMPACT_LEAF) {
+			bestWeights[n] = weights[n];
+			subtreeWords[n] = 1;
+		}
+		uint32_t children = __builtin_popcount(nodes[n].mask & COMPACT_CHILDREN);
+		for (uint32_t c = 0; c < children; c++) {
+			uint32_t child = nodes[n].firstChild + c;
+			bestWeights[n] = std::max(bestWeights[n], bestWeights[child]);
+			subtreeWords[n] += subtreeWords[child];
+		}
+	}
+
+	// precomputed answers for the prefixes whose searches would be longest
+	cacheIndex.assign(nodeCount, 0);
+	std::vector<Completion> completions;
+	for (uint32_t n = 0; n < nodeCount; n++) {
+		if (subtreeWords[n] >= COMPLETION_CACHE_WORDS) {
+			search(n, COMPLETION_CACHE_K, completions);
+			cacheIndex[n] = cache.size() + 1;
+			cache.insert(cache.end(), completions.begin(), completions.end());
+		}
+	}
+	LOG_INFO("Completer built: %u nodes, %lu cached prefixes, %lu B.", nodeCount,
+		cache.size() / COMPLETION_CACHE_K, getSize());
+
+	return true;
+}
+
+bool Completer::loadWeights(const char* weightFileName) {
+	ifstream file;
+	if (weightFileName != NULL) {
+		file.open(weightFileName);
+	}
+	if (!file.is_open()) {
+		LOG_ERROR("Unable to open word weight file '%s'.", (weightFileName != NULL) ? weightFileName : "");
+		return false;
+	}
+
+	const CompactTrieNode* nodes = trie->getNodes();
+	string word;
+	unsigned long weight;
+	uint32_t loaded = 0;
+	while (file >> word >> weight) {
+		uint32_t node = 0;
+		for (size_t i = 0; (i < word.length()) && (node != 0 || i == 0); i++) {
+			int index = charToIndex(toupper(word[i]));
+			node = ((index >= 0) && (index < 26)) ? CompactTrie::child(&nodes[node], index) : 0;
+		}
+		if ((node != 0) && (nodes[node].mask & COMPACT_LEAF)) {
+			weights[node] = (weight > UINT32_MAX) ? UINT32_MAX : weight;
+			loaded++;
+		}
+	}
+	LOG_INFO("Loaded weights for %u words from '%s'.", loaded, weightFileName);
+
+	return true;
+}
+
+uint32_t Completer::complete(const string& prefix, size_t k, std::vector<Completion>& completions) const {
+	completions.clear();
+	if (trie == NULL) {
+		return 0;
+	}
+
+	const CompactTrieNode* nodes = trie->getNodes();
+	uint32_t node = 0;
+	for (size_t i = 0; i < prefix.length(); i++) {
+		int index = charToIndex(toupper(prefix[i]));
+		if ((index < 0) || (index >= 26)) { return 0; }
+		node = CompactTrie::child(&nodes[node], index);
+		if (node == 0) { return 0; }
+	}
+
+	if ((cacheIndex[node] != 0) && (k <= COMPLETION_CACHE_K)) {
+		std::vector<Completion>::const_iterator first = cache.begin() + (cacheIndex[node] - 1);
+		completions.assign(first, first + k);
+	} else {
+		search(node, k, completions);
+	}
+
+	return subtreeWords[node];
+}
+
+void Completer::search(uint32_t node, size_t k, std::vector<Completion>& completions) const {
+	// best-first; a node's key bounds every word below it, so words pop in rank order
+	const CompactTrieNode* nodes = trie->getNodes();
+	std::priority_queue<CompletionEntry> queue;
+	CompletionEntry entry = { bestWeights[node], nodes[node].wordId, node, false };
+	queue.push(entry);
+	completions.clear();
+
+	while (!queue.empty() && (completions.size() < k)) {
+		entry = queue.top();
+		queue.pop();
+		if (entry.isWord) {
+			Completion completion = { entry.wordId, entry.weight };
+			completions.push_back(completion);
+			continue;
+		}
+
+		const CompactTrieNode& current = nodes[entry.node];
+		if (current.mask & COMPACT_LEAF) {
+			CompletionEntry word = { weights[entry.node], current.wordId, entry.node, true };
+			queue.push(word);
+		}
+		uint32_t children = __builtin_popcount(current.mask & COMPACT_CHILDREN);
+		for (uint32_t c = 0; c < children; c++) {
+			uint32_t child = current.firstChild + c;
+			CompletionEntry next = { bestWeights[child], nodes[child].wordId, child, false };
+			queue.push(next);
+		}
+	}
+}
+
+size_t Completer::getSize() const {
+	return (weights.size() + bestWeights.size() + subtreeWords.size() + cacheIndex.size()) * sizeof(uint32_t)
+		+ cache.size() * sizeof(Completion);
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+
+#include "DiceSet.h"
+#include "Logger.h"
+#include "Trie.h"
+
+// the dice shipped with the game, also in misc/Dice.txt
+static const char* standardDice[DICE_COUNT] = {
+	"AAAFRS", "AAEEEE", "AAFIRS", "ADENNN", "AEEEEM",
+	"AEEGMU", "AEGMNN", "AFIRSY", "BJKQXZ", "CCENST",
+	"CEIILT", "CEILPT", "CEIPST", "DDHNOT", "DHHLNO",
+	"DHHLOR", "DHLNOR", "EIIITT", "EMOTTT", "ENSSSU",
+	"FIPRSY", "GORRVW", "IKLQUW", "NOOTUW", "OOOTTU"
+};
+
+DiceSet::DiceSet() {
+	for (int d = 0; d < DICE_COUNT; d++) {
+		dice[d] = standardDice[d];
+	}
+	loadLetterDice();
+}
+
+bool DiceSet::load(const char* fileName) {
+	ifstream file(fileName);
+	if (!file.is_open()) {
+		LOG_ERROR("Unable to open dice file '%s'.", fileName);
+		return false;
+	}
+
+	// one die per line, DICE_FACES letters each
+	string loaded[DICE_COUNT];
+	string line;
+	int count = 0;
+	while (getline(file, line)) {
+		string faces;
+		for (size_t i = 0; i < line.length(); i++) {
+			if (isalpha(line[i])) { faces += toupper(line[i]); }
+		}
+		if (faces.empty()) { continue; }
+		if ((faces.length() != DICE_FACES) || (count == DICE_COUNT)) {
+			LOG_ERROR("Dice file '%s' needs %d dice of %d faces.", fileName, DICE_COUNT, DICE_FACES);
+			return false;
+		}
+		loaded[count++] = faces;
+	}
+	if (count != DICE_COUNT) {
+		LOG_ERROR("Dice file '%s' has %d dice, expected %d.", fileName, count, DICE_COUNT);
+		return false;
+	}
+
+	for (int d = 0; d < DICE_COUNT; d++) {
+		dice[d] = loaded[d];
+	}
+	loadLetterDice();
+
+	return true;
+}
+
+void DiceSet::loadLetterDice() {
+	for (int k = 0; k < 26; k++) {
+		letterDice[k] = 0;
+	}
+	for (int d = 0; d < DICE_COUNT; d++) {
+		for (int f = 0; f < DICE_FACES; f++) {
+			letterDice[charToIndex(dice[d][f])] |= 1u << d;
+		}
+	}
+}
+
+DiceFit DiceSet::fit(const string& word) const {
+	// one letter per die, "QU" together on a Q face
+	int letters[DICE_COUNT];
+	int count = 0;
+	for (size_t i = 0; i < word.length(); i++) {
+		if (count == DICE_COUNT) {
+			return DICE_TOO_LONG;
+		}
+		int index = charToIndex(toupper(word[i]));
+		if ((index < 0) || (index >= 26)) {
+			return DICE_LETTERS;
+		}
+		if (index == charToIndex('Q')) {
+			if ((i + 1 == word.length()) || (toupper(word[i + 1]) != 'U')) {
+				return DICE_BARE_Q;
+			}
+			i++;
+		}
+		letters[count++] = index;
+	}
+
+	// cheap necessary condition first: enough dice carry each letter
+	int counts[26] = {};
+	for (int p = 0; p < count; p++) {
+		if (++counts[letters[p]] > __builtin_popcount(letterDice[letters[p]])) {
+			return DICE_LETTERS;
+		}
+	}
+
+	int owners[DICE_COUNT];
+	std::fill(owners, owners + DICE_COUNT, -1);
+	for (int p = 0; p < count; p++) {
+		uint32_t tried = 0;
+		if (!match(letters, p, tried, owners)) {
+			return DICE_LETTERS;
+		}
+	}
+
+	return DICE_FIT;
+}
+
+bool DiceSet::match(const int* letters, int position, uint32_t& tried, int* owners) const {
+	// augmenting path: take a free die, or one whose owner can move to another
+	for (uint32_t candidates = letterDice[letters[position]] & ~tried; candidates != 0; candidates &= candidates - 1) {
+		int die = __builtin_ctz(candidates);
+		if (tried & (1u << die)) { continue; }
+		tried |= 1u << die;
+		if ((owners[die] < 0) || match(letters, owners[die], tried, owners)) {
+			owners[die] = position;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t DiceSet::getKey() const {
+	// FNV-1a over the dice with their faces sorted, so neither order matters
+	string sorted[DICE_COUNT];
+	for (int d = 0; d < DICE_COUNT; d++) {
+		sorted[d] = dice[d];
+		std::sort(sorted[d].begin(), sorted[d].end());
+	}
+	std::sort(sorted, sorted + DICE_COUNT);
+
+	uint32_t key = 2166136261u;
+	for (int d = 0; d < DICE_COUNT; d++) {
+		for (size_t f = 0; f < sorted[d].length(); f++) {
+			key = (key ^ (uint8_t)sorted[d][f]) * 16777619u;
+		}
+	}
+
+	return key;
+}
+
+string DiceSet::keyedFileName(const string& fileName) const {
+	// BoggleWords.trie -> BoggleWords.1234abcd.trie
+	char key[16];
+	snprintf(key, sizeof(key), ".%08x", getKey());
+	size_t dot = fileName.rfind('.');
+	if ((dot == string::npos) || (fileName.find('/', dot) != string::npos)) {
+		return fileName + key;
+	}
+
+	return fileName.substr(0, dot) + key + fileName.substr(dot);
+}
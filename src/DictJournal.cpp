@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+#include "DictJournal.h"
+#include "Logger.h"
+
+using std::ios;
+
+DictJournal::DictJournal() {
+	records = 0;
+	compacting = false;
+	compacted = true;
+}
+
+DictJournal::~DictJournal() {
+	waitCompaction();
+	close();
+}
+
+void DictJournal::open(const char* trieFileName) {
+	// the journal file itself is created by the first append
+	std::lock_guard<std::mutex> guard(lock);
+	this->trieFileName = trieFileName;
+	journalFileName = this->trieFileName + JOURNAL_SUFFIX;
+}
+
+void DictJournal::close() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (file.is_open()) {
+		file.close();
+	}
+}
+
+bool DictJournal::append(bool insert, const string& word) {
+	bool compact;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!file.is_open()) {
+			file.open(journalFileName.c_str(), ios::out | ios::binary | ios::app);
+		}
+		if (!file.is_open()) {
+			LOG_ERROR("Unable to open dictionary journal '%s'.", journalFileName.c_str());
+			return false;
+		}
+		file << (insert ? '+' : '-') << word << '\n';
+		file.flush();
+		if (!file) {
+			LOG_ERROR("Unable to append to dictionary journal '%s'.", journalFileName.c_str());
+			return false;
+		}
+		records++;
+		compact = (records >= JOURNAL_COMPACT_RECORDS) && !compacting;
+	}
+
+	if (compact) {
+		startCompaction();
+	}
+
+	return true;
+}
+
+uint64_t DictJournal::replay(Trie& trie) {
+	uint64_t endOffset;
+	uint64_t count = replayFile(journalFileName, trie, endOffset);
+	if (count > 0) {
+		LOG_INFO("Replayed %lu dictionary journal records.", count);
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	records = count;
+
+	return count;
+}
+
+uint64_t DictJournal::replayFile(const string& fileName, Trie& trie, uint64_t& endOffset) {
+	endOffset = 0;
+	ifstream file;
+	file.open(fileName.c_str(), ios::in | ios::binary);
+	if (!file.is_open()) {
+		return 0;
+	}
+	string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	uint64_t count = 0;
+	size_t start = 0, end;
+	while ((end = data.find('\n', start)) != string::npos) {
+		string word = data.substr(start + 1, end - start - 1);
+		char op = data[start];
+		start = end + 1;
+
+		bool valid = !word.empty() && ((op == '+') || (op == '-'));
+		for (size_t i = 0; valid && (i < word.length()); i++) {
+			valid = (word[i] >= 'A') && (word[i] <= 'Z');
+		}
+		if (!valid) {
+			LOG_INFO("Skipping malformed dictionary journal record at offset %lu.", endOffset);
+			endOffset = start;
+			continue;
+		}
+
+		if (op == '+') {
+			trie.insert(word.c_str(), word.length());
+		} else {
+			trie.erase(word.c_str(), word.length());
+		}
+		endOffset = start;
+		count++;
+	}
+	if (start < data.length()) {
+		LOG_INFO("Ignoring torn dictionary journal record at offset %lu.", endOffset);
+	}
+
+	return count;
+}
+
+bool DictJournal::startCompaction() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (compacting || journalFileName.empty()) {
+		return false;
+	}
+	if (compactor.joinable()) {
+		compactor.join();
+	}
+	compacting = true;
+	compactor = std::thread(&DictJournal::compact, this);
+
+	return true;
+}
+
+bool DictJournal::waitCompaction() {
+	if (compactor.joinable()) {
+		compactor.join();
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	return compacted;
+}
+
+uint64_t DictJournal::getRecordCount() {
+	std::lock_guard<std::mutex> guard(lock);
+	return records;
+}
+
+void DictJournal::compact() {
+	LOG_INFO("Compacting dictionary journal into '%s'.", trieFileName.c_str());
+
+	// base trie plus every complete record so far, built off to the side
+	Trie base;
+	uint64_t endOffset = 0;
+	string tmpTrieFileName = trieFileName + ".tmp";
+	bool ret = base.deserialize(trieFileName.c_str());
+	if (ret) {
+		if (replayFile(journalFileName, base, endOffset) > 0) {
+			// a node layout profiled on the old base no longer matches its nodes
+			base.setLayout(std::vector<uint32_t>());
+		}
+		ret = base.serialize(tmpTrieFileName.c_str());
+	}
+	base.clearTrie();
+
+	std::lock_guard<std::mutex> guard(lock);
+	if (ret) {
+		// carry over what was appended meanwhile, then swap both files in
+		string tail;
+		ifstream journal;
+		journal.open(journalFileName.c_str(), ios::in | ios::binary);
+		if (journal.is_open()) {
+			journal.seekg(endOffset);
+			tail.assign((std::istreambuf_iterator<char>(journal)), std::istreambuf_iterator<char>());
+		}
+
+		string tmpJournalFileName = journalFileName + ".tmp";
+		ofstream newJournal;
+		newJournal.open(tmpJournalFileName.c_str(), ios::out | ios::binary | ios::trunc);
+		newJournal << tail;
+		newJournal.close();
+
+		ret = !newJournal.fail() && (rename(tmpTrieFileName.c_str(), trieFileName.c_str()) == 0);
+		if (ret) {
+			// a crash before this rename replays records the new base already holds
+			file.close();
+			ret = (rename(tmpJournalFileName.c_str(), journalFileName.c_str()) == 0);
+			records = std::count(tail.begin(), tail.end(), '\n');
+		}
+	}
+	if (!ret) {
+		LOG_ERROR("Dictionary journal compaction failed; keeping the journal.");
+	}
+	compacting = false;
+	compacted = ret;
+}
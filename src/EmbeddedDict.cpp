@@ -0,0 +1,39 @@
+#include "CompactTrie.h"
+
+#if EMBEDDED_DICT
+
+#ifndef EMBEDDED_DICT_FILE
+#define EMBEDDED_DICT_FILE "BoggleWords.ctrie"
+#endif
+
+// link the compact trie written by 'BoggleMain --compile-trie' into .rodata
+__asm__(
+	".section .rodata\n"
+	".balign 64\n"
+	".global embeddedDictData\n"
+	"embeddedDictData:\n"
+	".incbin \"" EMBEDDED_DICT_FILE "\"\n"
+	".global embeddedDictEnd\n"
+	"embeddedDictEnd:\n"
+	".previous\n");
+
+extern "C" const char embeddedDictData[];
+extern "C" const char embeddedDictEnd[];
+
+bool getEmbeddedDict(const void*& data, size_t& size) {
+	data = embeddedDictData;
+	size = embeddedDictEnd - embeddedDictData;
+
+	return true;
+}
+
+#else
+
+bool getEmbeddedDict(const void*& data, size_t& size) {
+	data = NULL;
+	size = 0;
+
+	return false;
+}
+
+#endif
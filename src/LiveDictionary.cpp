@@ -0,0 +1,193 @@
+#include <chrono>
+
+#include "LiveDictionary.h"
+#include "Logger.h"
+
+using std::chrono::steady_clock;
+
+/******************
+ * LiveDictionary *
+ ******************/
+
+LiveDictionary::LiveDictionary(const char* dictFileName, const char* trieFileName) {
+	for (int s = 0; s < MAX_READERS; s++) {
+		slots[s].epoch.store(0);
+		slots[s].used.store(false);
+	}
+	epoch.store(1);
+	reloaded = true;
+	current.store(loadSnapshot(dictFileName, trieFileName, 1));
+}
+
+LiveDictionary::~LiveDictionary() {
+	// readers must be gone by now
+	waitReload();
+	std::lock_guard<std::mutex> guard(writerLock);
+	for (size_t r = 0; r < retired.size(); r++) {
+		delete retired[r]->boggle;
+		delete retired[r];
+	}
+	DictionarySnapshot* snapshot = current.load();
+	delete snapshot->boggle;
+	delete snapshot;
+}
+
+DictionarySnapshot* LiveDictionary::loadSnapshot(const char* dictFileName, const char* trieFileName, uint64_t generation) {
+	// readers share the compact trie, so that is all a snapshot keeps
+	DictionarySnapshot* snapshot = new DictionarySnapshot();
+	snapshot->boggle = new Boggle(dictFileName, trieFileName, LAYOUT_COMPACT);
+	snapshot->generation = generation;
+	snapshot->retireEpoch = 0;
+
+	return snapshot;
+}
+
+bool LiveDictionary::reload(const char* dictFileName, const char* trieFileName) {
+	std::lock_guard<std::mutex> guard(writerLock);
+	steady_clock::time_point start = steady_clock::now();
+
+	DictionarySnapshot* snapshot = loadSnapshot(dictFileName, trieFileName, current.load()->generation + 1);
+	if (snapshot->boggle->getTrieInfo().wordCount == 0) {
+		LOG_ERROR("New dictionary from '%s' is empty; keeping generation %lu.", trieFileName, current.load()->generation);
+		delete snapshot->boggle;
+		delete snapshot;
+		return false;
+	}
+	steady_clock::time_point loaded = steady_clock::now();
+
+	// publish, then move readers to a new epoch
+	DictionarySnapshot* old = current.exchange(snapshot);
+	old->retireEpoch = epoch.fetch_add(1) + 1;
+	retired.push_back(old);
+	steady_clock::time_point published = steady_clock::now();
+
+	LOG_INFO("Dictionary generation %lu published: load_ms=%.1f publish_us=%.1f", snapshot->generation,
+		std::chrono::duration<double, std::milli>(loaded - start).count(),
+		std::chrono::duration<double, std::micro>(published - loaded).count());
+	reclaimRetired();
+
+	return true;
+}
+
+bool LiveDictionary::startReload(const char* dictFileName, const char* trieFileName) {
+	if (reloader.joinable()) {
+		return false;
+	}
+	// the file names must stay valid until waitReload
+	reloader = std::thread([this, dictFileName, trieFileName]() {
+		bool ret = reload(dictFileName, trieFileName);
+		std::lock_guard<std::mutex> guard(writerLock);
+		reloaded = ret;
+	});
+
+	return true;
+}
+
+bool LiveDictionary::waitReload() {
+	if (reloader.joinable()) {
+		reloader.join();
+	}
+
+	std::lock_guard<std::mutex> guard(writerLock);
+	return reloaded;
+}
+
+bool LiveDictionary::reclaim() {
+	std::lock_guard<std::mutex> guard(writerLock);
+	return reclaimRetired();
+}
+
+bool LiveDictionary::reclaimRetired() {
+	// a reader without a slot may be on any snapshot; try again next time
+	std::unique_lock<std::shared_mutex> overflow(overflowLock, std::try_to_lock);
+	if (!overflow.owns_lock()) {
+		return retired.empty();
+	}
+
+	// oldest epoch any reader may still be working in
+	uint64_t oldest = UINT64_MAX;
+	for (int s = 0; s < MAX_READERS; s++) {
+		uint64_t readerEpoch = slots[s].epoch.load();
+		if ((readerEpoch != 0) && (readerEpoch < oldest)) {
+			oldest = readerEpoch;
+		}
+	}
+
+	size_t kept = 0;
+	for (size_t r = 0; r < retired.size(); r++) {
+		if (retired[r]->retireEpoch <= oldest) {
+			LOG_INFO("Dictionary generation %lu reclaimed.", retired[r]->generation);
+			delete retired[r]->boggle;
+			delete retired[r];
+		} else {
+			retired[kept++] = retired[r];
+		}
+	}
+	retired.resize(kept);
+
+	return retired.empty();
+}
+
+int LiveDictionary::registerReader() {
+	for (int s = 0; s < MAX_READERS; s++) {
+		bool used = false;
+		if (slots[s].used.compare_exchange_strong(used, true)) {
+			return s;
+		}
+	}
+	LOG_ERROR("All %d dictionary reader slots are taken; reading under a lock.", MAX_READERS);
+
+	return -1;
+}
+
+void LiveDictionary::unregisterReader(int slot) {
+	slots[slot].epoch.store(0);
+	slots[slot].used.store(false);
+}
+
+const DictionarySnapshot* LiveDictionary::enter(int slot) {
+	if (slot < 0) {
+		overflowLock.lock_shared();
+		return current.load();
+	}
+	// announce the epoch before looking at the snapshot
+	slots[slot].epoch.store(epoch.load());
+	return current.load();
+}
+
+void LiveDictionary::exit(int slot) {
+	if (slot < 0) {
+		overflowLock.unlock_shared();
+		return;
+	}
+	slots[slot].epoch.store(0);
+}
+
+/********************
+ * DictionaryReader *
+ ********************/
+
+DictionaryReader::DictionaryReader(LiveDictionary& live) : live(live) {
+	slot = live.registerReader();
+	solver = NULL;
+	generation = 0;
+}
+
+DictionaryReader::~DictionaryReader() {
+	delete solver;
+	if (slot >= 0) {
+		live.unregisterReader(slot);
+	}
+}
+
+Boggle& DictionaryReader::begin() {
+	const DictionarySnapshot* snapshot = live.enter(slot);
+	if (solver == NULL) {
+		solver = new Boggle(snapshot->boggle);
+	} else if (snapshot->generation != generation) {
+		solver->shareDictionary(snapshot->boggle);
+	}
+	generation = snapshot->generation;
+
+	return *solver;
+}
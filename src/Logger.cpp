@@ -52,3 +52,13 @@ void Logger::log(const char* fmt, ...) {
 		fflush(logFile);
 	}
 }
+
+void Logger::echo(bool error, const char* fmt, ...) {
+	FILE* console = error ? errorConsole : infoConsole;
+	if (console != NULL) {
+		va_list args;
+		va_start(args, fmt);
+		vfprintf(console, fmt, args);
+		va_end(args);
+	}
+}
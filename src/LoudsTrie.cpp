@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "Logger.h"
+#include "LoudsTrie.h"
+#include "Trie.h"
+
+#define LEAF_BIT (1u << 31)
+#define MASK_A (1u << 25)
+#define LABEL_BITS 5
+#define WORD_BLOCKS (RANK_BLOCK / 64)
+
+using std::ios;
+
+/*************
+ * BitVector *
+ *************/
+
+BitVector::BitVector() {
+	clear();
+}
+
+void BitVector::clear() {
+	words.clear();
+	ranks.clear();
+	zeroSamples.clear();
+	oneSamples.clear();
+	bits = 0;
+	ones = 0;
+}
+
+void BitVector::push(bool bit) {
+	if ((bits & 63) == 0) {
+		words.push_back(0);
+	}
+	if (bit) {
+		words.back() |= 1ull << (bits & 63);
+	}
+	bits++;
+}
+
+void BitVector::build() {
+	// pad to a whole rank block so scans never run off the end
+	words.resize(((words.size() + WORD_BLOCKS - 1) / WORD_BLOCKS) * WORD_BLOCKS, 0);
+	words.shrink_to_fit();
+
+	ranks.clear();
+	zeroSamples.clear();
+	oneSamples.clear();
+	uint64_t count = 0;
+	for (size_t w = 0; w < words.size(); w++) {
+		if ((w % WORD_BLOCKS) == 0) {
+			uint64_t block = w / WORD_BLOCKS;
+			uint64_t zeros = block * RANK_BLOCK - count;
+			ranks.push_back(count);
+			// first block holding the (n * SELECT_SAMPLE)-th one or zero
+			while (oneSamples.size() * SELECT_SAMPLE < count) { oneSamples.push_back(block - 1); }
+			while (zeroSamples.size() * SELECT_SAMPLE < zeros) { zeroSamples.push_back(block - 1); }
+		}
+		count += __builtin_popcountll(words[w]);
+	}
+	ranks.push_back(count);
+	ones = count;
+
+	uint64_t lastBlock = (words.size() / WORD_BLOCKS) - 1;
+	uint64_t zeros = words.size() * 64 - ones;
+	while (oneSamples.size() * SELECT_SAMPLE < ones) { oneSamples.push_back(lastBlock); }
+	while (zeroSamples.size() * SELECT_SAMPLE < zeros) { zeroSamples.push_back(lastBlock); }
+}
+
+uint64_t BitVector::rank1(uint64_t pos) const {
+	uint64_t block = pos / RANK_BLOCK;
+	uint64_t count = ranks[block];
+	for (uint64_t w = block * WORD_BLOCKS; w < (pos >> 6); w++) {
+		count += __builtin_popcountll(words[w]);
+	}
+	if (pos & 63) {
+		count += __builtin_popcountll(words[pos >> 6] & ((1ull << (pos & 63)) - 1));
+	}
+
+	return count;
+}
+
+uint64_t BitVector::select0(uint64_t k) const {
+	return select(k, false);
+}
+
+uint64_t BitVector::select1(uint64_t k) const {
+	return select(k, true);
+}
+
+uint64_t BitVector::select(uint64_t k, bool one) const {
+	// position of the k-th (from 0) one or zero
+	const std::vector<uint32_t>& samples = one ? oneSamples : zeroSamples;
+	uint64_t block = samples[k / SELECT_SAMPLE];
+
+	for (;;) {
+		uint64_t before = one ? ranks[block + 1] : (block + 1) * RANK_BLOCK - ranks[block + 1];
+		if (before > k) { break; }
+		block++;
+	}
+
+	uint64_t count = one ? ranks[block] : block * RANK_BLOCK - ranks[block];
+	uint64_t w = block * WORD_BLOCKS;
+	for (;; w++) {
+		uint64_t word = one ? words[w] : ~words[w];
+		uint64_t pop = __builtin_popcountll(word);
+		if (count + pop > k) {
+			for (uint64_t skip = k - count; skip > 0; skip--) {
+				word &= word - 1;
+			}
+			return (w << 6) + __builtin_ctzll(word);
+		}
+		count += pop;
+	}
+}
+
+size_t BitVector::getSize() const {
+	return words.size() * sizeof(uint64_t)
+		+ (ranks.size() + zeroSamples.size() + oneSamples.size()) * sizeof(uint32_t);
+}
+
+/***************
+ * PackedArray *
+ ***************/
+
+void PackedArray::init(int width, uint64_t count) {
+	this->width = width;
+	this->count = count;
+	words.assign((width * count + 63) / 64 + 1, 0);
+}
+
+uint32_t PackedArray::get(uint64_t i) const {
+	uint64_t bit = i * width;
+	uint64_t value = words[bit >> 6] >> (bit & 63);
+	if ((bit & 63) + width > 64) {
+		value |= words[(bit >> 6) + 1] << (64 - (bit & 63));
+	}
+
+	return value & ((1ull << width) - 1);
+}
+
+void PackedArray::set(uint64_t i, uint32_t value) {
+	uint64_t bit = i * width;
+	uint64_t mask = (1ull << width) - 1;
+	words[bit >> 6] &= ~(mask << (bit & 63));
+	words[bit >> 6] |= ((uint64_t)value & mask) << (bit & 63);
+	if ((bit & 63) + width > 64) {
+		int low = 64 - (bit & 63);
+		words[(bit >> 6) + 1] &= ~(mask >> low);
+		words[(bit >> 6) + 1] |= ((uint64_t)value & mask) >> low;
+	}
+}
+
+/*************
+ * LoudsTrie *
+ *************/
+
+LoudsTrie::LoudsTrie() {
+	nodeCount = 0;
+	wordCount = 0;
+	owner = NULL;
+}
+
+void LoudsTrie::clear() {
+	tree.clear();
+	leaves.clear();
+	labels.clear();
+	ids.clear();
+	levelLeaves.clear();
+	nodeCount = 0;
+	wordCount = 0;
+	owner = NULL;
+}
+
+void LoudsTrie::share(const LoudsTrie& trie) {
+	// read another trie's bits in place; 'trie' must outlive this one
+	clear();
+	owner = &trie.getOwner();
+	nodeCount = owner->nodeCount;
+	wordCount = owner->wordCount;
+}
+
+bool LoudsTrie::build(const uint32_t* masks, uint32_t count) {
+	clear();
+
+	uint64_t edges = 0;
+	for (uint32_t n = 0; n < count; n++) {
+		edges += __builtin_popcount(masks[n] & ~LEAF_BIT);
+	}
+	if ((count == 0) || (edges != count - 1)) {
+		LOG_INFO("Trie corrupt: %u nodes but %lu edges.", count, edges);
+		return false;
+	}
+
+	labels.init(LABEL_BITS, edges);
+	uint64_t edge = 0;
+	uint32_t words = 0;
+	uint32_t levelEnd = 0;	// first node of the next depth
+	for (uint32_t n = 0; n < count; n++) {
+		if (n == levelEnd) {
+			levelLeaves.push_back(words);
+			levelEnd = edge + 1;
+		}
+		uint32_t indexMask = MASK_A;
+		for (int i = 0; i < 26; i++, indexMask >>= 1) {
+			if (masks[n] & indexMask) {
+				tree.push(true);
+				labels.set(edge++, i);
+			}
+		}
+		tree.push(false);
+		leaves.push(masks[n] & LEAF_BIT);
+		if (masks[n] & LEAF_BIT) { words++; }
+	}
+	tree.build();
+	leaves.build();
+	levelLeaves.push_back(words);
+	nodeCount = count;
+	wordCount = words;
+
+	// word IDs follow lexicographic order, as in Trie::assignWordIds
+	int width = 1;
+	while ((width < 32) && ((1ull << width) < wordCount)) { width++; }
+	ids.init(width, wordCount);
+	assignWordIds(0, 0);
+
+	return true;
+}
+
+uint32_t LoudsTrie::assignWordIds(uint32_t node, uint32_t nextId) {
+	if (isLeaf(node)) {
+		uint64_t rank = leaves.rank1(node);
+		ids.set(rank, nextId);
+		nextId++;
+	}
+
+	uint64_t start = blockStart(node);
+	for (uint64_t pos = start; tree.get(pos); pos++) {
+		nextId = assignWordIds(pos - node + 1, nextId);
+	}
+
+	return nextId;
+}
+
+bool LoudsTrie::load(const char* fileName) {
+	LOG_INFO("Building LOUDS trie from trie file '%s'.", fileName);
+	ifstream file;
+	file.open(fileName, ios::in | ios::binary | ios::ate);
+	if (!file.is_open()) {
+		LOG_INFO("Unable to open trie file for LOUDS build.");
+		return false;
+	}
+
+	size_t size = file.tellg();
+	std::vector<uint32_t> masks(size / sizeof(uint32_t));
+	file.seekg(0);
+	file.read((char*)masks.data(), masks.size() * sizeof(uint32_t));
+	if (!file) {
+		LOG_INFO("Unable to read trie file for LOUDS build.");
+		return false;
+	}
+
+	// the node stream ends once every announced child has been read
+	uint64_t expected = 1, count = 0;
+	while ((count < expected) && (count < masks.size())) {
+		expected += __builtin_popcount(masks[count++] & ~LEAF_BIT);
+	}
+	if (count < expected) {
+		LOG_INFO("Trie corrupt: node list is longer than file.");
+		return false;
+	}
+
+	return build(masks.data(), count);
+}
+
+uint32_t LoudsTrie::child(uint32_t node, uint64_t start, int index) const {
+	// the node's edges are the run of 1 bits at 'start'
+	uint64_t edge = start - node;
+	for (uint64_t pos = start; tree.get(pos); pos++, edge++) {
+		int label = labels.get(edge);
+		if (label == index) { return edge + 1; }
+		if (label > index) { break; }
+	}
+
+	return 0;
+}
+
+uint32_t LoudsTrie::childMask(uint32_t node, uint64_t start) const {
+	uint32_t mask = 0;
+	uint64_t edge = start - node;
+	for (uint64_t pos = start; tree.get(pos); pos++, edge++) {
+		mask |= 1u << labels.get(edge);
+	}
+
+	return mask;
+}
+
+const uint64_t* LoudsTrie::labelWord(uint64_t edge) const {
+	return labels.address(edge);
+}
+
+uint32_t LoudsTrie::parent(uint32_t node) const {
+	// node's edge is the (node - 1)-th one; zeros before it count the parents
+	return tree.select1(node - 1) - (node - 1);
+}
+
+bool LoudsTrie::getWord(uint32_t wordId, string& word) const {
+	if (owner != NULL) {
+		return owner->getWord(wordId, word);
+	}
+	word.clear();
+	if (wordId >= wordCount) {
+		return false;
+	}
+
+	// each depth's leaves hold increasing IDs
+	uint64_t rank = wordCount;
+	for (size_t level = 0; (level + 1 < levelLeaves.size()) && (rank == wordCount); level++) {
+		uint64_t low = levelLeaves[level], high = levelLeaves[level + 1];
+		if ((low == high) || (ids.get(low) > wordId) || (ids.get(high - 1) < wordId)) {
+			continue;
+		}
+		while (low < high) {
+			uint64_t mid = (low + high) / 2;
+			if (ids.get(mid) < wordId) { low = mid + 1; } else { high = mid; }
+		}
+		if (ids.get(low) == wordId) { rank = low; }
+	}
+	if (rank == wordCount) {
+		return false;
+	}
+
+	uint32_t node = leaves.select1(rank);
+	while (node != 0) {
+		word += indexToChar(labels.get(node - 1));
+		node = parent(node);
+	}
+	std::reverse(word.begin(), word.end());
+
+	return true;
+}
+
+size_t LoudsTrie::getSize() const {
+	if (owner != NULL) {
+		return owner->getSize();
+	}
+	return sizeof(*this) + tree.getSize() + leaves.getSize() + labels.getSize() + ids.getSize() +
+		levelLeaves.size() * sizeof(uint32_t);
+}
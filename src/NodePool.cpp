@@ -0,0 +1,185 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "Logger.h"
+#include "NodePool.h"
+
+#define alignUp(n, a) (((n) + (a) - 1) & ~((size_t)(a) - 1))
+
+NodePool* NodePool::instance = NULL;
+
+const char* pageModeName(PageMode mode) {
+	switch (mode) {
+		case PAGES_TRANSPARENT: return "transparent";
+		case PAGES_EXPLICIT: return "explicit";
+		default: return "default";
+	}
+}
+
+bool parsePageMode(const char* name, PageMode& mode) {
+	if (strcmp(name, "default") == 0) { mode = PAGES_DEFAULT; }
+	else if (strcmp(name, "transparent") == 0) { mode = PAGES_TRANSPARENT; }
+	else if (strcmp(name, "explicit") == 0) { mode = PAGES_EXPLICIT; }
+	else { return false; }
+
+	return true;
+}
+
+void* allocPages(size_t size, PageMode mode, PageMode& actual) {
+#if defined(__linux__)
+	size = alignUp(size, HUGE_PAGE_SIZE);
+
+#if defined(MAP_HUGETLB)
+	if (mode == PAGES_EXPLICIT) {
+		void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED) {
+			actual = PAGES_EXPLICIT;
+			return memory;
+		}
+		LOG_DEBUG("MAP_HUGETLB failed (%s), trying transparent huge pages", strerror(errno));
+	}
+#endif
+
+	if (mode != PAGES_DEFAULT) {
+		// over-allocate so the region can be trimmed to huge page alignment
+		size_t mapped = size + HUGE_PAGE_SIZE;
+		char* memory = (char*)mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) {
+			return NULL;
+		}
+		char* aligned = (char*)alignUp((uintptr_t)memory, HUGE_PAGE_SIZE);
+		if (aligned > memory) { munmap(memory, aligned - memory); }
+		if (aligned + size < memory + mapped) { munmap(aligned + size, (memory + mapped) - (aligned + size)); }
+
+		actual = PAGES_DEFAULT;
+#if defined(MADV_HUGEPAGE)
+		if (madvise(aligned, size, MADV_HUGEPAGE) == 0) {
+			actual = PAGES_TRANSPARENT;
+		} else {
+			LOG_DEBUG("MADV_HUGEPAGE failed (%s), using regular pages", strerror(errno));
+		}
+#endif
+		return aligned;
+	}
+
+	void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	actual = PAGES_DEFAULT;
+	return (memory != MAP_FAILED) ? memory : NULL;
+#else
+	actual = PAGES_DEFAULT;
+	return malloc(size);
+#endif
+}
+
+void freePages(void* memory, size_t size) {
+	if (memory == NULL) { return; }
+
+#if defined(__linux__)
+	munmap(memory, alignUp(size, HUGE_PAGE_SIZE));
+#else
+	free(memory);
+#endif
+}
+
+NodePool::NodePool() {
+	freeList = NULL;
+	chunkUsed = POOL_CHUNK_SIZE;
+	nodeSize = 0;
+	live = 0;
+	mode = PAGES_DEFAULT;
+	granted = PAGES_DEFAULT;
+}
+
+NodePool::~NodePool() {
+	releaseChunks();
+}
+
+NodePool* NodePool::Instance() {
+	if (!instance) {
+		instance = new NodePool();
+	}
+
+	return instance;
+}
+
+void* NodePool::allocate(size_t size) {
+	std::lock_guard<std::mutex> guard(lock);
+
+	// the pool serves a single node type
+	size = alignUp(size, sizeof(void*));
+	if (nodeSize == 0) { nodeSize = size; }
+	if (size != nodeSize) { throw std::bad_alloc(); }
+
+	live++;
+	if (freeList != NULL) {
+		void* node = freeList;
+		freeList = *(void**)node;
+		return node;
+	}
+
+	if (chunkUsed + nodeSize > POOL_CHUNK_SIZE) {
+		Chunk chunk;
+		chunk.memory = (char*)allocPages(POOL_CHUNK_SIZE, mode, chunk.mode);
+		if (chunk.memory == NULL) {
+			live--;
+			throw std::bad_alloc();
+		}
+		if (chunk.mode != granted) {
+			LOG_INFO("Requested %s pages for trie storage, got %s pages", pageModeName(mode), pageModeName(chunk.mode));
+		}
+		granted = chunk.mode;
+		chunks.push_back(chunk);
+		chunkUsed = 0;
+	}
+
+	void* node = chunks.back().memory + chunkUsed;
+	chunkUsed += nodeSize;
+	return node;
+}
+
+void NodePool::deallocate(void* node) {
+	if (node == NULL) { return; }
+	std::lock_guard<std::mutex> guard(lock);
+
+	*(void**)node = freeList;
+	freeList = node;
+	live--;
+
+	if (live == 0) {
+		releaseChunks();
+	}
+}
+
+PageMode NodePool::getPageMode() {
+	return mode;
+}
+
+PageMode NodePool::getGrantedPageMode() {
+	return granted;
+}
+
+size_t NodePool::getMappedBytes() {
+	std::lock_guard<std::mutex> guard(lock);
+	return chunks.size() * POOL_CHUNK_SIZE;
+}
+
+void NodePool::setPageMode(PageMode mode) {
+	std::lock_guard<std::mutex> guard(lock);
+	this->mode = mode;
+	granted = mode;
+}
+
+void NodePool::releaseChunks() {
+	for (size_t i = 0; i < chunks.size(); i++) {
+		freePages(chunks[i].memory, POOL_CHUNK_SIZE);
+	}
+	chunks.clear();
+	freeList = NULL;
+	chunkUsed = POOL_CHUNK_SIZE;
+}
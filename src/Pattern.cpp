@@ -0,0 +1,92 @@
+#include <cctype>
+
+#include "Logger.h"
+#include "Pattern.h"
+#include "Trie.h"
+
+bool Pattern::parse(const string& pattern) {
+	tokenCount = 0;
+	stars = 0;
+	for (size_t i = 0; i < pattern.length(); i++) {
+		if (tokenCount == PATTERN_MAX_TOKENS) {
+			LOG_ERROR("Pattern '%s' has more than %d tokens.", pattern.c_str(), PATTERN_MAX_TOKENS);
+			return false;
+		}
+
+		char c = toupper(pattern[i]);
+		uint32_t mask = 0;
+		if (c == '?') {
+			mask = ALL_LETTERS;
+		} else if (c == '*') {
+			mask = ALL_LETTERS;
+			stars |= 1ull << tokenCount;
+		} else if (c == '[') {
+			bool negate = (i + 1 < pattern.length()) && (pattern[i + 1] == '^');
+			for (i += negate ? 2 : 1; (i < pattern.length()) && (pattern[i] != ']'); i++) {
+				int first = charToIndex(toupper(pattern[i]));
+				int last = first;
+				if ((i + 2 < pattern.length()) && (pattern[i + 1] == '-') && (pattern[i + 2] != ']')) {
+					last = charToIndex(toupper(pattern[i + 2]));
+					i += 2;
+				}
+				if ((first < 0) || (last >= 26) || (first > last)) { mask = 0; break; }
+				for (int k = first; k <= last; k++) { mask |= 1u << k; }
+			}
+			if ((i == pattern.length()) || (pattern[i] != ']')) { mask = 0; }
+			if (negate && (mask != 0)) { mask = ~mask & ALL_LETTERS; }
+		} else if ((c >= 'A') && (c <= 'Z')) {
+			mask = 1u << charToIndex(c);
+		}
+		if (mask == 0) {
+			LOG_ERROR("Pattern '%s' is malformed at position %lu.", pattern.c_str(), i);
+			tokenCount = 0;
+			return false;
+		}
+
+		// "**" is the same as "*"
+		if ((stars & (1ull << tokenCount)) && (tokenCount > 0) && (stars & (1ull << (tokenCount - 1)))) {
+			stars &= ~(1ull << tokenCount);
+			continue;
+		}
+		masks[tokenCount++] = mask;
+	}
+
+	for (int k = 0; k < 26; k++) {
+		advance[k] = 0;
+		stay[k] = 0;
+		for (int t = 0; t < tokenCount; t++) {
+			if (!(masks[t] & (1u << k))) { continue; }
+			if (stars & (1ull << t)) {
+				stay[k] |= 1ull << t;
+			} else {
+				advance[k] |= 1ull << t;
+			}
+		}
+	}
+
+	return true;
+}
+
+uint64_t Pattern::closure(uint64_t states) const {
+	// a star can be skipped; stars come in order, so one ascending pass is enough
+	for (int t = 0; t < tokenCount; t++) {
+		if ((states & stars & (1ull << t))) {
+			states |= 1ull << (t + 1);
+		}
+	}
+
+	return states;
+}
+
+uint64_t Pattern::step(uint64_t states, int letter) const {
+	return closure((states & stay[letter]) | ((states & advance[letter]) << 1));
+}
+
+uint32_t Pattern::letters(uint64_t states) const {
+	uint32_t mask = 0;
+	for (uint64_t live = states & ((1ull << tokenCount) - 1); live != 0; live &= live - 1) {
+		mask |= masks[__builtin_ctzll(live)];
+	}
+
+	return mask;
+}
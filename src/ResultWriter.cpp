@@ -0,0 +1,178 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include "ResultWriter.h"
+
+ResultWriter::ResultWriter(std::ostream& stream, OutputFormat format, bool listWords)
+	: stream(stream), format(format), listWords(listWords) {
+	buffer = new char[WRITER_BUFFER];
+	bufferSize = 0;
+}
+
+ResultWriter::~ResultWriter() {
+	flush();
+	delete[] buffer;
+}
+
+void ResultWriter::append(const char* data, size_t len) {
+	while (len > 0) {
+		reserve(1);
+		size_t chunk = WRITER_BUFFER - bufferSize;
+		if (chunk > len) { chunk = len; }
+		std::memcpy(&buffer[bufferSize], data, chunk);
+		bufferSize += chunk;
+		data += chunk;
+		len -= chunk;
+	}
+}
+
+void ResultWriter::appendf(const char* fmt, ...) {
+	reserve(WRITER_RESERVE);
+
+	va_list args, retry;
+	va_start(args, fmt);
+	va_copy(retry, args);
+	int len = vsnprintf(&buffer[bufferSize], WRITER_BUFFER - bufferSize, fmt, args);
+	va_end(args);
+
+	// vsnprintf returns the length it would have written; a longer line goes
+	// out on an empty buffer, and one longer than the buffer is cut short
+	if ((len > 0) && ((size_t)len >= WRITER_BUFFER - bufferSize)) {
+		reserve(WRITER_BUFFER);
+		len = vsnprintf(buffer, WRITER_BUFFER, fmt, retry);
+		if ((len > 0) && ((size_t)len >= WRITER_BUFFER)) {
+			LOG_ERROR("Result line of %d B truncated to %d B", len, WRITER_BUFFER - 1);
+			len = WRITER_BUFFER - 1;
+		}
+	}
+	va_end(retry);
+
+	if (len > 0) {
+		bufferSize += len;
+	}
+}
+
+void ResultWriter::appendPath(const WordPath& path) {
+	for (uint32_t step = 0; step < path.length; step++) {
+		appendf((step > 0) ? ",%d" : "%d", path.getCell(step));
+	}
+}
+
+void ResultWriter::flush() {
+	if (bufferSize > 0) {
+		stream.write(buffer, bufferSize);
+		bufferSize = 0;
+	}
+	stream.flush();
+}
+
+void ResultWriter::reserve(size_t len) {
+	if (WRITER_BUFFER - bufferSize < len) {
+		stream.write(buffer, bufferSize);
+		bufferSize = 0;
+	}
+}
+
+void ResultWriter::write(const char* letters, const SolveResult& result) {
+	switch (format) {
+		case FORMAT_TEXT: writeText(letters, result); break;
+		case FORMAT_JSON: writeJson(letters, result); break;
+		case FORMAT_BINARY: writeBinary(letters, result); break;
+	}
+}
+
+void ResultWriter::writeText(const char* letters, const SolveResult& result) {
+	for (int i = 0; i < BOARD_SIZE; i++) {
+		append("+---+---+---+---+---+\n|", 23);
+		for (int j = 0; j < BOARD_SIZE; j++) {
+			char tmp = letters[i * BOARD_SIZE + j];
+			appendf(" %c%s", tmp, (tmp != 'Q') ? " |" : "u|");
+		}
+		append("\n", 1);
+	}
+	append("+---+---+---+---+---+\n", 22);
+
+	if (listWords) {
+		// a word's paths follow it, one cell list each
+		size_t path = 0;
+		for (size_t i = 0; i < result.words.size(); i++) {
+			append(result.words[i].c_str(), result.words[i].length());
+			for (; (path < result.paths.size()) && (result.paths[path].wordId == result.wordIds[i]); path++) {
+				append(" ", 1);
+				appendPath(result.paths[path]);
+			}
+			append("\n", 1);
+		}
+	}
+
+	for (int i = 0; i < WORD_COUNTS; i++) {
+		if (result.wordCounts[i] > 0) {
+			appendf("%d-letter words: %d\n", i + MIN_WORD_LENGTH, result.wordCounts[i]);
+		}
+	}
+	appendf("Total points: %d\n", result.points);
+	if (!result.complete) {
+		append("Search stopped early, results are partial\n", 42);
+	}
+}
+
+void ResultWriter::writeJson(const char* letters, const SolveResult& result) {
+	append("{\"board\":\"", 10);
+	append(letters, BOARD_CELLS);
+	appendf("\",\"points\":%d,\"counts\":{", result.points);
+
+	bool first = true;
+	for (int i = 0; i < WORD_COUNTS; i++) {
+		if (result.wordCounts[i] > 0) {
+			appendf("%s\"%d\":%d", first ? "" : ",", i + MIN_WORD_LENGTH, result.wordCounts[i]);
+			first = false;
+		}
+	}
+	append("}", 1);
+	if (!result.complete) {
+		append(",\"complete\":false", 17);
+	}
+
+	if (listWords) {
+		append(",\"words\":[", 10);
+		for (size_t i = 0; i < result.words.size(); i++) {
+			// words are A-Z only, nothing to escape
+			if (i > 0) { append(",", 1); }
+			append("\"", 1);
+			append(result.words[i].c_str(), result.words[i].length());
+			append("\"", 1);
+		}
+		append("]", 1);
+
+		if (!result.paths.empty()) {
+			// paths[i] lists the paths of words[i]
+			append(",\"paths\":[", 10);
+			size_t path = 0;
+			for (size_t i = 0; i < result.words.size(); i++) {
+				append((i > 0) ? ",[" : "[", (i > 0) ? 2 : 1);
+				for (size_t first = path; (path < result.paths.size()) && (result.paths[path].wordId == result.wordIds[i]);
+						path++) {
+					append((path > first) ? ",[" : "[", (path > first) ? 2 : 1);
+					appendPath(result.paths[path]);
+					append("]", 1);
+				}
+				append("]", 1);
+			}
+			append("]", 1);
+		}
+	}
+	append("}\n", 2);
+}
+
+void ResultWriter::writeBinary(const char* letters, const SolveResult& result) {
+	uint32_t points = result.points;
+	uint32_t wordCount = listWords ? result.wordIds.size() : 0;
+
+	append(letters, BOARD_CELLS);
+	append((const char*)&points, sizeof(points));
+	append((const char*)&wordCount, sizeof(wordCount));
+	if (wordCount > 0) {
+		append((const char*)&result.wordIds[0], wordCount * sizeof(uint32_t));
+	}
+}
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "Logger.h"
+#include "Simulation.h"
+
+using std::ios;
+
+/**************
+ * BoardStats *
+ **************/
+
+void BoardStats::clear(unsigned int seed, uint32_t wordCount, uint64_t dictionaryHash) {
+	this->seed = seed;
+	this->dictionaryHash = dictionaryHash;
+	boards = 0;
+	for (int i = 0; i < WORD_COUNTS; i++) {
+		wordCounts[i] = 0;
+	}
+	scores.clear();
+	wordFrequency.assign(wordCount, 0);
+}
+
+void BoardStats::add(const SolveResult& result) {
+	boards++;
+	for (int i = 0; i < WORD_COUNTS; i++) {
+		wordCounts[i] += result.wordCounts[i];
+	}
+	if ((size_t)result.points >= scores.size()) {
+		scores.resize(result.points + 1, 0);
+	}
+	scores[result.points]++;
+	for (size_t i = 0; i < result.wordIds.size(); i++) {
+		wordFrequency[result.wordIds[i]]++;
+	}
+}
+
+void BoardStats::merge(const BoardStats& stats) {
+	boards += stats.boards;
+	for (int i = 0; i < WORD_COUNTS; i++) {
+		wordCounts[i] += stats.wordCounts[i];
+	}
+	if (stats.scores.size() > scores.size()) {
+		scores.resize(stats.scores.size(), 0);
+	}
+	for (size_t i = 0; i < stats.scores.size(); i++) {
+		scores[i] += stats.scores[i];
+	}
+	for (size_t i = 0; i < stats.wordFrequency.size(); i++) {
+		wordFrequency[i] += stats.wordFrequency[i];
+	}
+}
+
+bool BoardStats::load(const char* fileName) {
+	ifstream file;
+	file.open(fileName, ios::in | ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	StatsHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || (header.magic != STATS_MAGIC)) {
+		LOG_ERROR("Checkpoint file '%s' has a bad header.", fileName);
+		return false;
+	}
+	seed = header.seed;
+	dictionaryHash = header.dictionaryHash;
+	boards = header.boards;
+	scores.resize(header.scoreCount);
+	wordFrequency.resize(header.wordCount);
+	file.read((char*)wordCounts, sizeof(wordCounts));
+	file.read((char*)scores.data(), scores.size() * sizeof(uint64_t));
+	file.read((char*)wordFrequency.data(), wordFrequency.size() * sizeof(uint64_t));
+	if (!file) {
+		LOG_ERROR("Checkpoint file '%s' is truncated.", fileName);
+		return false;
+	}
+
+	return true;
+}
+
+bool BoardStats::save(const char* fileName) const {
+	// write beside the old checkpoint and swap, so a kill never leaves half a file
+	string tmpFileName = string(fileName) + ".tmp";
+	ofstream file;
+	file.open(tmpFileName.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!file.is_open()) {
+		LOG_ERROR("Unable to open checkpoint file '%s' for writing.", tmpFileName.c_str());
+		return false;
+	}
+
+	StatsHeader header;
+	header.magic = STATS_MAGIC;
+	header.seed = seed;
+	header.boards = boards;
+	header.wordCount = wordFrequency.size();
+	header.scoreCount = scores.size();
+	header.dictionaryHash = dictionaryHash;
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)wordCounts, sizeof(wordCounts));
+	file.write((const char*)scores.data(), scores.size() * sizeof(uint64_t));
+	file.write((const char*)wordFrequency.data(), wordFrequency.size() * sizeof(uint64_t));
+	file.close();
+	if (file.fail()) {
+		LOG_ERROR("Unable to write checkpoint file '%s'.", tmpFileName.c_str());
+		return false;
+	}
+
+	return rename(tmpFileName.c_str(), fileName) == 0;
+}
+
+void BoardStats::report(std::ostream& stream, Boggle& boggle) const {
+	char line[128];
+	if (boards == 0) {
+		stream << "boards 0" << std::endl;
+		return;
+	}
+
+	// score distribution
+	double sum = 0.0, sumSquares = 0.0;
+	for (size_t p = 0; p < scores.size(); p++) {
+		sum += (double)p * scores[p];
+		sumSquares += (double)p * p * scores[p];
+	}
+	double mean = sum / boards;
+	double deviation = sqrt(std::max(0.0, sumSquares / boards - mean * mean));
+	const double quantiles[] = { 0.0, 0.1, 0.5, 0.9, 0.99, 1.0 };
+	const char* quantileNames[] = { "min", "p10", "p50", "p90", "p99", "max" };
+	snprintf(line, sizeof(line), "boards %lu seed %u\npoints mean %.2f sd %.2f", boards, seed, mean, deviation);
+	stream << line;
+	uint64_t seen = 0;
+	size_t p = 0;
+	for (int q = 0; q < 6; q++) {
+		// smallest score with at least the quantile's share of boards at or below it
+		uint64_t target = std::max<uint64_t>(1, (uint64_t)ceil(quantiles[q] * boards));
+		while ((seen + scores[p] < target) && (p + 1 < scores.size())) {
+			seen += scores[p++];
+		}
+		stream << " " << quantileNames[q] << " " << p;
+	}
+	stream << std::endl;
+
+	stream << "score histogram (" << REPORT_SCORE_BUCKET << " points per bucket):";
+	for (size_t bucket = 0; bucket < scores.size(); bucket += REPORT_SCORE_BUCKET) {
+		uint64_t count = 0;
+		for (size_t p = bucket; (p < bucket + REPORT_SCORE_BUCKET) && (p < scores.size()); p++) {
+			count += scores[p];
+		}
+		stream << " " << count;
+	}
+	stream << std::endl;
+
+	// expected words per board by length
+	stream << "words per board by length:";
+	for (int i = 0; i < WORD_COUNTS; i++) {
+		if (wordCounts[i] > 0) {
+			snprintf(line, sizeof(line), " %d:%.3f", i + MIN_WORD_LENGTH, (double)wordCounts[i] / boards);
+			stream << line;
+		}
+	}
+	stream << std::endl;
+
+	// most frequent words
+	std::vector<uint32_t> top;
+	for (uint32_t id = 0; id < wordFrequency.size(); id++) {
+		if (wordFrequency[id] > 0) { top.push_back(id); }
+	}
+	size_t topCount = std::min<size_t>(REPORT_TOP_WORDS, top.size());
+	std::partial_sort(top.begin(), top.begin() + topCount, top.end(),
+		[this](uint32_t a, uint32_t b) { return wordFrequency[a] > wordFrequency[b]; });
+	snprintf(line, sizeof(line), "distinct words %lu, most frequent (share of boards):", top.size());
+	stream << line;
+	string word;
+	for (size_t i = 0; i < topCount; i++) {
+		boggle.getWord(top[i], word);
+		snprintf(line, sizeof(line), " %s:%.4f", word.c_str(), (double)wordFrequency[top[i]] / boards);
+		stream << line;
+	}
+	stream << std::endl;
+}
+
+/**************
+ * Simulation *
+ **************/
+
+Simulation::Simulation(Boggle& boggle, unsigned int threads) {
+	if (threads == 0) { threads = 1; }
+	wordCount = boggle.getTrieInfo().wordCount;
+	dictionaryHash = boggle.getDictionaryHash();
+	workers.push_back(&boggle);
+	for (unsigned int t = 1; t < threads; t++) {
+		workers.push_back(new Boggle(&boggle));
+	}
+}
+
+Simulation::~Simulation() {
+	for (size_t t = 1; t < workers.size(); t++) {
+		delete workers[t];
+	}
+}
+
+bool Simulation::run(uint64_t boards, unsigned int seed, const char* checkpointFileName, BoardStats& stats) {
+	stats.clear(seed, wordCount, dictionaryHash);
+	if ((checkpointFileName != NULL) && stats.load(checkpointFileName)) {
+		if ((stats.seed != seed) || (stats.wordFrequency.size() != wordCount)) {
+			LOG_ERROR("Checkpoint '%s' is for seed %u and %lu words, not seed %u and %u words.",
+				checkpointFileName, stats.seed, stats.wordFrequency.size(), seed, wordCount);
+			return false;
+		}
+		if (stats.dictionaryHash != dictionaryHash) {
+			LOG_ERROR("Checkpoint '%s' is for dictionary %016lx, not %016lx.", checkpointFileName,
+				stats.dictionaryHash, dictionaryHash);
+			return false;
+		}
+		LOG_INFO("Resuming simulation at board %lu of %lu.", stats.boards, boards);
+	} else {
+		stats.clear(seed, wordCount, dictionaryHash);
+	}
+
+	std::vector<BoardStats> threadStats(workers.size());
+	while (stats.boards < boards) {
+		uint64_t last = std::min<uint64_t>(stats.boards + SIM_BATCH, boards);
+		runBatch(stats.boards, last, seed, threadStats);
+		for (size_t t = 0; t < threadStats.size(); t++) {
+			stats.merge(threadStats[t]);
+		}
+
+		if ((checkpointFileName != NULL) && !stats.save(checkpointFileName)) {
+			return false;
+		}
+		LOG_INFO("Simulated %lu of %lu boards.", stats.boards, boards);
+	}
+
+	return true;
+}
+
+void Simulation::runBatch(uint64_t first, uint64_t last, unsigned int seed, std::vector<BoardStats>& threadStats) {
+	std::atomic<uint64_t> next(first);
+	std::vector<std::thread> threads;
+
+	for (size_t t = 0; t < workers.size(); t++) {
+		threadStats[t].clear(seed, wordCount, dictionaryHash);
+		threads.push_back(std::thread([this, t, last, seed, &next, &threadStats]() {
+			Boggle* boggle = workers[t];
+			BoardStats& local = threadStats[t];
+			SolveOptions options;
+			options.listWords = false;
+			SolveResult result;
+
+			for (;;) {
+				uint64_t board = next.fetch_add(SIM_CHUNK);
+				if (board >= last) { break; }
+				uint64_t end = std::min<uint64_t>(board + SIM_CHUNK, last);
+				for (; board < end; board++) {
+					boggle->newGame(seed + (unsigned int)board);
+					boggle->solve(result, options);
+					local.add(result);
+				}
+			}
+		}));
+	}
+
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+}
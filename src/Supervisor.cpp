@@ -0,0 +1,368 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <poll.h>
+#include <set>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "Supervisor.h"
+
+static bool readFull(int fd, void* data, size_t len) {
+	char* bytes = (char*)data;
+	while (len > 0) {
+		ssize_t n = read(fd, bytes, len);
+		if ((n < 0) && (errno == EINTR)) { continue; }
+		if (n <= 0) { return false; }
+		bytes += n;
+		len -= n;
+	}
+
+	return true;
+}
+
+static bool writeFull(int fd, const void* data, size_t len) {
+	const char* bytes = (const char*)data;
+	while (len > 0) {
+		ssize_t n = write(fd, bytes, len);
+		if ((n < 0) && (errno == EINTR)) { continue; }
+		if (n <= 0) { return false; }
+		bytes += n;
+		len -= n;
+	}
+
+	return true;
+}
+
+// resident and proportional set sizes of a process, in kB
+static bool readMemory(pid_t pid, long& rssKb, long& pssKb) {
+	char fileName[64];
+	snprintf(fileName, sizeof(fileName), "/proc/%d/smaps_rollup", (int)pid);
+	std::ifstream file(fileName);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	rssKb = pssKb = -1;
+	string line;
+	while (getline(file, line)) {
+		if (line.compare(0, 4, "Rss:") == 0) { rssKb = atol(line.c_str() + 4); }
+		if (line.compare(0, 4, "Pss:") == 0) { pssKb = atol(line.c_str() + 4); }
+	}
+
+	return (rssKb >= 0) && (pssKb >= 0);
+}
+
+Supervisor::Supervisor(Boggle& boggle, unsigned int workers) : boggle(boggle), seed(0), restarts(0), skipped(0) {
+	Worker idle = { -1, -1, -1, std::vector<char>(), std::deque<uint64_t>() };
+	this->workers.assign((workers > 0) ? workers : 1, idle);
+}
+
+Supervisor::~Supervisor() {
+	stopWorkers();
+}
+
+bool Supervisor::run(uint64_t boards, unsigned int seed, ResultWriter& writer, SolveOptions options) {
+	// the supervisor resolves words from the IDs; paths don't go over the pipe
+	options.listWords = false;
+	options.paths = PATHS_NONE;
+	this->seed = seed;
+	restarts = 0;
+	skipped = 0;
+
+	// a worker dying mid-job must not take the supervisor with it; the
+	// caller's handler is back once the run is over
+	void (*pipeHandler)(int) = signal(SIGPIPE, SIG_IGN);
+	bool ret = supervise(boards, writer, options);
+	signal(SIGPIPE, pipeHandler);
+
+	return ret;
+}
+
+bool Supervisor::supervise(uint64_t boards, ResultWriter& writer, const SolveOptions& options) {
+	for (size_t w = 0; w < workers.size(); w++) {
+		if (!startWorker(w, options)) {
+			stopWorkers();
+			return false;
+		}
+	}
+
+	std::deque<uint64_t> queue;		// boards handed back by crashed workers
+	std::map<uint64_t, SolveResult> ready;
+	std::map<uint64_t, string> readyBoards;
+	std::map<uint64_t, int> crashes;
+	std::set<uint64_t> skippedBoards;
+	uint64_t next = 0, written = 0;
+	std::vector<pollfd> fds;
+	std::vector<size_t> fdWorkers;
+	char chunk[1 << 16];
+
+	while (written < boards) {
+		fds.clear();
+		fdWorkers.clear();
+		for (size_t w = 0; w < workers.size(); w++) {
+			if (workers[w].boards.empty()) {
+				sendJob(workers[w], queue, next, boards);
+			}
+			if (!workers[w].boards.empty()) {
+				pollfd fd = { workers[w].resultFd, POLLIN, 0 };
+				fds.push_back(fd);
+				fdWorkers.push_back(w);
+			}
+		}
+		if (fds.empty()) {
+			LOG_ERROR("Supervisor has boards left to write but none in flight.");
+			stopWorkers();
+			return false;
+		}
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) { continue; }
+			LOG_ERROR("Supervisor poll failed: %s", strerror(errno));
+			stopWorkers();
+			return false;
+		}
+
+		for (size_t f = 0; f < fds.size(); f++) {
+			if (fds[f].revents == 0) { continue; }
+			Worker& worker = workers[fdWorkers[f]];
+			ssize_t n = read(worker.resultFd, chunk, sizeof(chunk));
+			if ((n < 0) && (errno == EINTR)) { continue; }
+			if (n > 0) {
+				worker.buffer.insert(worker.buffer.end(), chunk, chunk + n);
+				parseResults(worker, ready, readyBoards);
+				continue;
+			}
+
+			// the worker is gone; the first unanswered board is the one it died on
+			int status = 0;
+			waitpid(worker.pid, &status, 0);
+			if (WIFSIGNALED(status)) {
+				LOG_ERROR("Worker %d killed by signal %d.", (int)worker.pid, WTERMSIG(status));
+			} else {
+				LOG_ERROR("Worker %d exited with status %d.", (int)worker.pid, WEXITSTATUS(status));
+			}
+			if (!worker.boards.empty()) {
+				uint64_t board = worker.boards.front();
+				if (++crashes[board] >= SUPERVISOR_RETRIES) {
+					LOG_ERROR("Skipping board with seed %u after %d worker crashes.", seed + (unsigned int)board,
+						crashes[board]);
+					skippedBoards.insert(board);
+					skipped++;
+					worker.boards.pop_front();
+				}
+				queue.insert(queue.begin(), worker.boards.begin(), worker.boards.end());
+			}
+			close(worker.jobFd);
+			close(worker.resultFd);
+			worker.pid = -1;
+			restarts++;
+			if (!startWorker(fdWorkers[f], options)) {
+				stopWorkers();
+				return false;
+			}
+		}
+
+		// write whatever is next in seed order
+		while (written < boards) {
+			if (skippedBoards.count(written) > 0) {
+				written++;
+				continue;
+			}
+			std::map<uint64_t, SolveResult>::iterator result = ready.find(written);
+			if (result == ready.end()) {
+				break;
+			}
+			if (writer.needsWords()) {
+				result->second.words.resize(result->second.wordIds.size());
+				for (size_t i = 0; i < result->second.wordIds.size(); i++) {
+					boggle.getWord(result->second.wordIds[i], result->second.words[i]);
+				}
+			}
+			writer.write(readyBoards[written].c_str(), result->second);
+			ready.erase(result);
+			readyBoards.erase(written);
+			written++;
+		}
+	}
+
+	reportMemory();
+	stopWorkers();
+
+	return true;
+}
+
+void Supervisor::solveBoard(unsigned int seed, SolveResult& result, const SolveOptions& options) {
+	boggle.newGame(seed);
+	boggle.solve(result, options);
+}
+
+bool Supervisor::startWorker(size_t w, const SolveOptions& options) {
+	int jobPipe[2], resultPipe[2];
+	if (pipe(jobPipe) < 0) {
+		LOG_ERROR("Unable to create worker pipe: %s", strerror(errno));
+		return false;
+	}
+	if (pipe(resultPipe) < 0) {
+		LOG_ERROR("Unable to create worker pipe: %s", strerror(errno));
+		close(jobPipe[0]);
+		close(jobPipe[1]);
+		return false;
+	}
+
+	// nothing buffered may be written twice
+	fflush(NULL);
+	pid_t pid = fork();
+	if (pid < 0) {
+		LOG_ERROR("Unable to fork worker: %s", strerror(errno));
+		close(jobPipe[0]);
+		close(jobPipe[1]);
+		close(resultPipe[0]);
+		close(resultPipe[1]);
+		return false;
+	}
+
+	if (pid == 0) {
+		// worker: keep only its own pipe ends, and skip the supervisor's exit path
+		close(jobPipe[1]);
+		close(resultPipe[0]);
+		for (size_t v = 0; v < workers.size(); v++) {
+			if (workers[v].pid > 0) {
+				close(workers[v].jobFd);
+				close(workers[v].resultFd);
+			}
+		}
+		workerLoop(jobPipe[0], resultPipe[1], options);
+		_exit(0);
+	}
+
+	close(jobPipe[0]);
+	close(resultPipe[1]);
+	workers[w].pid = pid;
+	workers[w].jobFd = jobPipe[1];
+	workers[w].resultFd = resultPipe[0];
+	workers[w].buffer.clear();
+	workers[w].boards.clear();
+
+	return true;
+}
+
+void Supervisor::stopWorkers() {
+	// closing the job pipe is the signal to exit
+	for (size_t w = 0; w < workers.size(); w++) {
+		if (workers[w].pid > 0) {
+			close(workers[w].jobFd);
+		}
+	}
+	for (size_t w = 0; w < workers.size(); w++) {
+		if (workers[w].pid > 0) {
+			close(workers[w].resultFd);
+			waitpid(workers[w].pid, NULL, 0);
+			workers[w].pid = -1;
+		}
+	}
+}
+
+void Supervisor::workerLoop(int jobFd, int resultFd, const SolveOptions& options) {
+	uint64_t positions[SUPERVISOR_CHUNK];
+	char letters[BOARD_CELLS + 1];
+	SolveResult result;
+
+	while (true) {
+		uint32_t count;
+		if (!readFull(jobFd, &count, sizeof(count)) || (count == 0) || (count > SUPERVISOR_CHUNK)) {
+			return;
+		}
+		if (!readFull(jobFd, positions, count * sizeof(uint64_t))) {
+			return;
+		}
+
+		for (uint32_t k = 0; k < count; k++) {
+			solveBoard(seed + (unsigned int)positions[k], result, options);
+			boggle.getBoard(letters);
+
+			// zeroed, so no stale padding goes down the pipe
+			WorkerRecord record;
+			std::memset(&record, 0, sizeof(record));
+			record.position = positions[k];
+			record.points = result.points;
+			record.wordCount = result.wordIds.size();
+			record.complete = result.complete;
+			std::memcpy(record.wordCounts, result.wordCounts, sizeof(record.wordCounts));
+			std::memcpy(record.board, letters, BOARD_CELLS);
+			if (!writeFull(resultFd, &record, sizeof(record)) ||
+					!writeFull(resultFd, result.wordIds.data(), result.wordIds.size() * sizeof(uint32_t))) {
+				return;
+			}
+		}
+	}
+}
+
+bool Supervisor::sendJob(Worker& worker, std::deque<uint64_t>& queue, uint64_t& next, uint64_t end) {
+	// boards handed back by crashed workers first
+	uint64_t positions[SUPERVISOR_CHUNK];
+	uint32_t count = 0;
+	while ((count < SUPERVISOR_CHUNK) && !queue.empty()) {
+		positions[count++] = queue.front();
+		queue.pop_front();
+	}
+	while ((count < SUPERVISOR_CHUNK) && (next < end)) {
+		positions[count++] = next++;
+	}
+	if (count == 0) {
+		return false;
+	}
+
+	// a failed write means the worker died; its read end reports that
+	worker.boards.assign(positions, positions + count);
+	return writeFull(worker.jobFd, &count, sizeof(count)) && writeFull(worker.jobFd, positions, count * sizeof(uint64_t));
+}
+
+void Supervisor::parseResults(Worker& worker, std::map<uint64_t, SolveResult>& ready, std::map<uint64_t, string>& boards) {
+	size_t offset = 0;
+	while (worker.buffer.size() - offset >= sizeof(WorkerRecord)) {
+		WorkerRecord record = {};
+		std::memcpy(&record, &worker.buffer[offset], sizeof(record));
+		size_t len = sizeof(record) + record.wordCount * sizeof(uint32_t);
+		if (worker.buffer.size() - offset < len) {
+			break;
+		}
+
+		SolveResult& result = ready[record.position];
+		result.points = record.points;
+		result.complete = (record.complete != 0);
+		std::memcpy(result.wordCounts, record.wordCounts, sizeof(result.wordCounts));
+		result.wordIds.resize(record.wordCount);
+		if (record.wordCount > 0) {
+			std::memcpy(result.wordIds.data(), &worker.buffer[offset + sizeof(record)], record.wordCount * sizeof(uint32_t));
+		}
+		boards[record.position] = string(record.board, BOARD_CELLS);
+		if (!worker.boards.empty() && (worker.boards.front() == record.position)) {
+			worker.boards.pop_front();
+		}
+		offset += len;
+	}
+	worker.buffer.erase(worker.buffer.begin(), worker.buffer.begin() + offset);
+}
+
+void Supervisor::reportMemory() {
+	// PSS splits shared pages between their sharers, so its sum is the real footprint
+	long rssKb, pssKb, rssTotal = 0, pssTotal = 0;
+	if (!readMemory(getpid(), rssKb, pssKb)) {
+		return;
+	}
+	rssTotal += rssKb;
+	pssTotal += pssKb;
+	for (size_t w = 0; w < workers.size(); w++) {
+		if ((workers[w].pid > 0) && readMemory(workers[w].pid, rssKb, pssKb)) {
+			rssTotal += rssKb;
+			pssTotal += pssKb;
+		}
+	}
+	LOG_INFO("Supervisor and %lu workers: %ld MB resident summed, %ld MB proportional", workers.size(),
+		rssTotal / 1024, pssTotal / 1024);
+}
@@ -2,6 +2,7 @@
 #include <string>
 
 #include "Logger.h"
+#include "NodePool.h"
 #include "Trie.h"
 
 #define LEAF_BIT (1u << 31)
@@ -20,6 +21,10 @@ TrieNode::TrieNode() {
 		children[i] = NULL;
 	}
 	isLeaf = false;
+	dicts = 0;
+	below = 0;
+	wordId = 0;
+	hash = 0;
 }
 
 TrieNode::~TrieNode() {
@@ -30,12 +35,21 @@ TrieNode::~TrieNode() {
 	}
 }
 
+void* TrieNode::operator new(size_t size) {
+	return NodePool::Instance()->allocate(size);
+}
+
+void TrieNode::operator delete(void* node) {
+	NodePool::Instance()->deallocate(node);
+}
+
 Trie::Trie() {
 #if DEBUG
 	id = createTrieId();
 	LOG_DEBUG("Constructing Trie [%lu]", this->id);
 #endif
 	root = TrieNode();
+	hashed = false;
 }
 
 Trie::~Trie() {
@@ -47,11 +61,19 @@ TrieNode* Trie::getRoot() {
 }
 
 void Trie::clearTrie() {
-	root = TrieNode();
+	for (int i = 0; i < 26; i++) {
+		delete root.children[i];
+		root.children[i] = NULL;
+	}
+	root.isLeaf = false;
+	root.dicts = 0;
+	root.below = 0;
+	hashed = false;
 }
 
-void Trie::insert(const char* key, int len) {
+void Trie::insert(const char* key, int len, uint8_t dicts) {
 	TrieNode* child = getRoot();
+	child->below |= dicts;
 
 	for (int i = 0; i < len; i++) {
 		int index = charToIndex(key[i]);
@@ -60,9 +82,89 @@ void Trie::insert(const char* key, int len) {
 			child->children[index] = new TrieNode();
 		}
 		child = child->children[index];
+		child->below |= dicts;
 	}
 
 	child->isLeaf = true;
+	child->dicts |= dicts;
+	hashed = false;
+}
+
+bool Trie::erase(const char* key, int len, uint8_t dicts) {
+	std::vector<TrieNode*> path(1, getRoot());
+
+	for (int i = 0; i < len; i++) {
+		TrieNode* child = path.back()->children[charToIndex(key[i])];
+		if (child == NULL) {
+			return false;
+		}
+		path.push_back(child);
+	}
+	if (!path.back()->isLeaf || !(path.back()->dicts & dicts)) {
+		return false;
+	}
+	path.back()->dicts &= ~dicts;
+	path.back()->isLeaf = (path.back()->dicts != 0);
+	hashed = false;
+
+	// prune the nodes that no longer lead to a word, deepest first, and
+	// recount the dictionaries below the rest of the path
+	for (int i = len; i >= 0; i--) {
+		TrieNode* node = path[i];
+		node->below = node->dicts;
+		for (int c = 0; c < 26; c++) {
+			if (node->children[c] != NULL) { node->below |= node->children[c]->below; }
+		}
+		if ((i > 0) && (node->below == 0)) {
+			path[i - 1]->children[charToIndex(key[i - 1])] = NULL;
+			delete node;
+		}
+	}
+
+	return true;
+}
+
+uint32_t Trie::assignWordIds() {
+	return assignNodeWordIds(getRoot(), 0);
+}
+
+uint32_t Trie::assignNodeWordIds(TrieNode* node, uint32_t nextId) {
+	// word IDs follow lexicographic order, so a word comes before its extensions
+	node->wordId = nextId;
+	if (node->isLeaf) { nextId++; }
+
+	for (int i = 0; i < 26; i++) {
+		if (node->children[i] != NULL) {
+			nextId = assignNodeWordIds(node->children[i], nextId);
+		}
+	}
+
+	return nextId;
+}
+
+bool Trie::getWord(uint32_t wordId, string& word) {
+	TrieNode* node = getRoot();
+	word.clear();
+
+	while (!(node->isLeaf && (node->wordId == wordId))) {
+		// descend into the last child whose subtree starts at or before wordId
+		TrieNode* next = NULL;
+		int index = 0;
+		for (int i = 0; i < 26; i++) {
+			if ((node->children[i] != NULL) && (node->children[i]->wordId <= wordId)) {
+				next = node->children[i];
+				index = i;
+			}
+		}
+		if (next == NULL) {
+			return false;
+		}
+
+		word += indexToChar(index);
+		node = next;
+	}
+
+	return true;
 }
 
 LinkedTrieNode* Trie::nodeToUint32(uint32_t& output, TrieNode* node, LinkedTrieNode* tail) {
@@ -121,13 +223,20 @@ bool Trie::serialize(const char* fileName) {
 
 	// start at root node
 	LinkedTrieNode* head, * tail, * tmp;
-	uint32_t mask;
+	uint32_t mask, nodeCount = 0;
+	std::vector<uint8_t> dicts;		// per word, in node order
+	bool overlaid = false;
 	head = new LinkedTrieNode();
 	tail = head;
 	head->node = getRoot();
 
 	while (head != NULL) {
 		tail = nodeToUint32(mask, head->node, tail);
+		nodeCount++;
+		if (head->node->isLeaf) {
+			dicts.push_back(head->node->dicts);
+			overlaid = overlaid || (head->node->dicts != DICT_BASE);
+		}
 		// write mask to char buffer
 		std::memcpy(&buffer[bufferSize], &mask, BUFFERINC);
 		bufferSize += BUFFERINC;
@@ -149,13 +258,59 @@ bool Trie::serialize(const char* fileName) {
 		file.write(buffer, bufferSize);
 	}
 
+	// layout trailer: placement order, node count, magic
+	if (layout.size() == nodeCount) {
+		uint32_t footer[2] = { nodeCount, TRIE_LAYOUT_MAGIC };
+		file.write((const char*)layout.data(), nodeCount * sizeof(uint32_t));
+		file.write((const char*)footer, sizeof(footer));
+	} else if (!layout.empty()) {
+		LOG_INFO("Trie layout covers %lu nodes, trie has %u; dropping layout.", layout.size(), nodeCount);
+		layout.clear();
+	}
+
+	// dictionary trailer, when words are in other lists than the base one:
+	// each word's dictionaries in node order, word count, magic
+	if (overlaid) {
+		uint32_t footer[2] = { (uint32_t)dicts.size(), TRIE_DICTS_MAGIC };
+		file.write((const char*)dicts.data(), dicts.size());
+		file.write((const char*)footer, sizeof(footer));
+	}
+
+	// hash trailer, always last: root hash, magic
+	uint64_t hash = getHash();
+	uint32_t magic = TRIE_HASH_MAGIC;
+	file.write((const char*)&hash, sizeof(hash));
+	file.write((const char*)&magic, sizeof(magic));
+
 	file.close();
 
 	return true;
 }
 
-LinkedTrieNode* Trie::uint32ToNode(uint32_t input, TrieNode* node, LinkedTrieNode* tail) {
+void Trie::getMasks(std::vector<uint32_t>& masks) {
+	// the node stream serialize writes, kept in memory
+	LinkedTrieNode* head, * tail, * tmp;
+	uint32_t mask;
+	head = new LinkedTrieNode();
+	tail = head;
+	head->node = getRoot();
+	masks.clear();
+
+	while (head != NULL) {
+		tail = nodeToUint32(mask, head->node, tail);
+		masks.push_back(mask);
+
+		tmp = head;
+		head = head->next;
+		delete tmp;
+		tmp = NULL;
+	}
+}
+
+LinkedTrieNode* Trie::uint32ToNode(uint32_t input, TrieNode* node, LinkedTrieNode* tail,
+	std::vector<TrieNode*>& placed, size_t& nextPlaced) {
 	node->isLeaf = input & LEAF_BIT;
+	node->dicts = node->isLeaf ? DICT_BASE : 0;
 
 #if DEBUG
 	char logBuffer[59];
@@ -181,7 +336,8 @@ LinkedTrieNode* Trie::uint32ToNode(uint32_t input, TrieNode* node, LinkedTrieNod
 #if DEBUG
 			logBuffer[cx] = indexToChar(i);
 #endif
-			node->children[i] = new TrieNode();
+			// children arrive in breadth-first order, so take the next placed node
+			node->children[i] = (nextPlaced < placed.size()) ? placed[nextPlaced++] : new TrieNode();
 			// add node to end of processing list
 			tail->next = new LinkedTrieNode();
 			tail = tail->next;
@@ -202,6 +358,100 @@ LinkedTrieNode* Trie::uint32ToNode(uint32_t input, TrieNode* node, LinkedTrieNod
 	return tail;
 }
 
+bool Trie::readHash(ifstream& file, size_t& nodeBytes, uint64_t& hash) {
+	// a hash trailer is the root hash and the magic
+	uint32_t magic;
+	if (nodeBytes < sizeof(hash) + sizeof(magic)) {
+		return false;
+	}
+	file.seekg(nodeBytes - sizeof(hash) - sizeof(magic));
+	file.read((char*)&hash, sizeof(hash));
+	file.read((char*)&magic, sizeof(magic));
+	if (!file || (magic != TRIE_HASH_MAGIC)) {
+		file.clear();
+		return false;
+	}
+	nodeBytes -= sizeof(hash) + sizeof(magic);
+
+	return true;
+}
+
+bool Trie::readDicts(ifstream& file, size_t& nodeBytes, std::vector<uint8_t>& dicts) {
+	// a dictionary trailer is a byte per word, the word count and the magic
+	uint32_t footer[2];
+	dicts.clear();
+	if (nodeBytes < sizeof(footer)) {
+		return false;
+	}
+	file.seekg(nodeBytes - sizeof(footer));
+	file.read((char*)footer, sizeof(footer));
+	if (!file || (footer[1] != TRIE_DICTS_MAGIC)) {
+		file.clear();
+		return false;
+	}
+	if ((uint64_t)footer[0] + sizeof(footer) > nodeBytes) {
+		LOG_INFO("Trie dictionaries for %u words overrun the file; ignoring them.", footer[0]);
+		return false;
+	}
+	nodeBytes -= footer[0] + sizeof(footer);
+	dicts.resize(footer[0]);
+	file.seekg(nodeBytes);
+	file.read((char*)dicts.data(), dicts.size());
+
+	return (bool)file;
+}
+
+bool Trie::readFileHash(const char* fileName, uint64_t& hash) {
+	// a dictionary version check without loading the dictionary
+	ifstream file(fileName, ios::in | ios::ate | ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	size_t nodeBytes = file.tellg();
+
+	return readHash(file, nodeBytes, hash);
+}
+
+bool Trie::readLayout(ifstream& file, size_t& nodeBytes) {
+	// a layout trailer is the placement order, the node count and the magic
+	uint32_t footer[2];
+	layout.clear();
+	if (nodeBytes < sizeof(footer)) {
+		return false;
+	}
+	file.seekg(nodeBytes - sizeof(footer));
+	file.read((char*)footer, sizeof(footer));
+	if (!file || (footer[1] != TRIE_LAYOUT_MAGIC)) {
+		file.clear();
+		return false;
+	}
+
+	uint64_t trailerBytes = ((uint64_t)footer[0] + 2) * sizeof(uint32_t);
+	if ((footer[0] == 0) || (trailerBytes > nodeBytes) || ((uint64_t)footer[0] * sizeof(uint32_t) != nodeBytes - trailerBytes)) {
+		LOG_INFO("Trie layout for %u nodes does not match the node list; ignoring layout.", footer[0]);
+		return false;
+	}
+	nodeBytes -= trailerBytes;
+	layout.resize(footer[0]);
+	file.seekg(nodeBytes);
+	file.read((char*)layout.data(), layout.size() * sizeof(uint32_t));
+
+	// must be a permutation of the node indices
+	bool valid = (bool)file;
+	std::vector<bool> seen(layout.size(), false);
+	for (size_t n = 0; valid && (n < layout.size()); n++) {
+		valid = (layout[n] < layout.size()) && !seen[layout[n]];
+		if (valid) { seen[layout[n]] = true; }
+	}
+	if (!valid) {
+		LOG_INFO("Trie layout is not a node permutation; ignoring layout.");
+		file.clear();
+		layout.clear();
+	}
+
+	return valid;
+}
+
 bool Trie::deserialize(const char* fileName) {
 	LOG_INFO("Deserializing from trie file '%s'.", fileName);
 	int bufferSize = BUFFERMAX;
@@ -217,10 +467,31 @@ bool Trie::deserialize(const char* fileName) {
 		LOG_INFO("Unable to open trie file for deserialization.");
 		return false;
 	}
-	if (file.tellg() == 0) {
+	size_t remaining = file.tellg();
+	if (remaining == 0) {
 		LOG_INFO("Trie file is empty.");
 		return false;
 	}
+	uint64_t fileHash;
+	bool hasHash = readHash(file, remaining, fileHash);
+	std::vector<uint8_t> dicts;
+	bool overlaid = readDicts(file, remaining, dicts);
+	size_t nextWord = 0;
+
+	// with a layout, allocate every node up front in placement order so the
+	// hottest nodes share pages and cache lines; children then take them in
+	// breadth-first order
+	std::vector<TrieNode*> placed;
+	size_t nextPlaced = 1;
+	if (readLayout(file, remaining)) {
+		LOG_INFO("Placing %lu trie nodes in stored layout order.", layout.size());
+		placed.resize(layout.size(), NULL);
+		for (size_t n = 0; n < layout.size(); n++) {
+			if (layout[n] != 0) {
+				placed[layout[n]] = new TrieNode();
+			}
+		}
+	}
 	file.seekg(0);
 
 	LinkedTrieNode* head, * tail, * tmp;
@@ -228,25 +499,38 @@ bool Trie::deserialize(const char* fileName) {
 	head = new LinkedTrieNode();
 	tail = head;
 	head->node = getRoot();
+	bool ret = true;
 
-	while ((bufferPos < bufferSize) || !file.eof()) {
+	while ((bufferPos < bufferSize) || (remaining > 0)) {
 		if (head == NULL) {
 			LOG_INFO("Trie corrupt: file is longer than node list.");
-			clearTrie();
-			return false;
+			ret = false;
+			break;
 		}
 
 		if (bufferPos >= bufferSize) {
-			file.read(buffer, BUFFERMAX);
+			bufferSize = (remaining < BUFFERMAX) ? remaining : BUFFERMAX;
+			file.read(buffer, bufferSize);
 			if (!file) {
 				bufferSize = file.gcount();
 			}
+			remaining = (bufferSize > 0) ? remaining - bufferSize : 0;
 			bufferPos = 0;
+			continue;
 		}
-		
+
 		std::memcpy(&mask, &buffer[bufferPos], BUFFERINC);
 		bufferPos += BUFFERINC;
-		tail = uint32ToNode(mask, head->node, tail);
+		tail = uint32ToNode(mask, head->node, tail, placed, nextPlaced);
+		if (overlaid && head->node->isLeaf) {
+			// words take their dictionaries in node order
+			if ((nextWord >= dicts.size()) || (dicts[nextWord] == 0)) {
+				LOG_INFO("Trie corrupt: dictionary trailer does not match the words.");
+				ret = false;
+				break;
+			}
+			head->node->dicts = dicts[nextWord++];
+		}
 
 		// advance
 		tmp = head;
@@ -255,110 +539,131 @@ bool Trie::deserialize(const char* fileName) {
 		tmp = NULL;
 	}
 
-	if (head != NULL) {
+	if (ret && (head != NULL)) {
 		LOG_INFO("Trie corrupt: node list is longer than file.");
+		ret = false;
+	}
+	if (ret && overlaid && (nextWord != dicts.size())) {
+		LOG_INFO("Trie corrupt: dictionary trailer has %lu words, trie has %lu.", dicts.size(), nextWord);
+		ret = false;
+	}
+	if (ret) {
+		rehash();
+		if (hasHash && (root.hash != fileHash)) {
+			LOG_INFO("Trie corrupt: root hash %016lx, file says %016lx.", root.hash, fileHash);
+			ret = false;
+		}
+	}
 
+	if (!ret) {
 		// clean up remaining nodes in processing list
-		do {
+		while (head != NULL) {
 			tmp = head;
 			head = head->next;
 			delete tmp;
 			tmp = NULL;
-		} while (head != NULL);
+		}
+		// and placed nodes the node list never reached
+		for (; nextPlaced < placed.size(); nextPlaced++) {
+			delete placed[nextPlaced];
+		}
 		// clear partial trie
 		clearTrie();
-
-		return false;
+		layout.clear();
 	}
 
-	return true;
+	return ret;
 }
 
 bool Trie::trieCompare(Trie& trie) {
-	int level = 0, nodesInLevel = 0, nodesInNextLevel = 0;
-	TrieNode* currentHead, * currentStaticHead;
-	LinkedTrieNode* head, * staticHead, * tail, * staticTail, * tmpHead;
-	head = new LinkedTrieNode();
-	head->node = getRoot();
-	head->next = NULL;
-	tail = head;
-	staticHead = new LinkedTrieNode();
-	staticHead->node = trie.getRoot();
-	staticHead->next = NULL;
-	staticTail = staticHead;
-	nodesInLevel = 1;
-
-	while ((head != NULL) && (staticHead != NULL)) {
-		currentHead = head->node;
-		currentStaticHead = staticHead->node;
-		if (currentHead->isLeaf != currentStaticHead->isLeaf) {
-			LOG_DEBUG("currentHead->isLeaf = %s and currentStaticHead->isLeaf = %s.",
-				currentHead->isLeaf ? "TRUE" : "FALSE",
-				currentStaticHead->isLeaf ? "TRUE" : "FALSE");
-
-			// clean up processing lists
-			do {
-				tmpHead = head;
-				head = head->next;
-				delete tmpHead;
-			} while (head != NULL);
-			do {
-				tmpHead = staticHead;
-				staticHead = staticHead->next;
-				delete tmpHead;
-			} while (staticHead != NULL);
+	// equal subtrees have equal hashes; unequal ones collide with odds of 2^-64
+	return getHash() == trie.getHash();
+}
 
-			return false;
-		}
+uint64_t Trie::getHash() {
+	if (!hashed) {
+		rehash();
+	}
 
-		for (int i = 0; i < 26; i++) {
-			if ((currentHead->children[i] == NULL) ^ (currentStaticHead->children[i] == NULL)) {
-				LOG_DEBUG("Only %s has child %c.", currentHead->children[i] ? "currentHead" : "currentStaticHead", indexToChar(i));
-				return false;
-			}
-			if (currentHead->children[i]) {
-				// add child to processing list
-				tail->next = new LinkedTrieNode();
-				tail->next->node = currentHead->children[i];
-				tail = tail->next;
-				tail->next = NULL;
-
-				staticTail->next = new LinkedTrieNode();
-				staticTail->next->node = currentStaticHead->children[i];
-				staticTail = staticTail->next;
-				staticTail->next = NULL;
-
-				nodesInNextLevel++;
-			}
+	return root.hash;
+}
+
+void Trie::rehash() {
+	hashNode(getRoot());
+	hashed = true;
+}
+
+uint64_t Trie::hashNode(TrieNode* node) {
+	// bottom-up: fold each child's hash, tagged with its letter, into the node's;
+	// a word in the base list only hashes as it did before overlays. The same
+	// pass recounts the dictionaries below each node.
+	uint64_t hash = node->isLeaf ? HASH_LEAF + (node->dicts - DICT_BASE) : HASH_NODE;
+	node->below = node->dicts;
+	for (int i = 0; i < 26; i++) {
+		if (node->children[i] != NULL) {
+			hash = mixHash(hash ^ mixHash(hashNode(node->children[i]) + i + 1));
+			node->below |= node->children[i]->below;
 		}
+	}
+	node->hash = hash;
 
-		// advance processing lists
-		tmpHead = head;
-		head = head->next;
-		delete tmpHead;
-		tmpHead = NULL;
-
-		tmpHead = staticHead;
-		staticHead = staticHead->next;
-		delete tmpHead;
-		tmpHead = NULL;
-
-		nodesInLevel--;
-		if (nodesInLevel == 0) {
-			level++;
-			nodesInLevel = nodesInNextLevel;
-			nodesInNextLevel = 0;
+	return hash;
+}
+
+void Trie::diff(Trie& trie, std::vector<string>& added, std::vector<string>& removed) {
+	string word;
+	added.clear();
+	removed.clear();
+	getHash();
+	trie.getHash();
+	diffNodes(getRoot(), trie.getRoot(), word, added, removed);
+}
+
+void Trie::diffNodes(TrieNode* node, TrieNode* other, string& word, std::vector<string>& added,
+	std::vector<string>& removed) {
+	// only subtrees whose hashes differ are walked
+	if (node->hash == other->hash) {
+		return;
+	}
+	if (node->isLeaf && !other->isLeaf) {
+		removed.push_back(word);
+	} else if (!node->isLeaf && other->isLeaf) {
+		added.push_back(word);
+	}
+
+	for (int i = 0; i < 26; i++) {
+		if ((node->children[i] == NULL) && (other->children[i] == NULL)) {
+			continue;
+		}
+		word.push_back(indexToChar(i));
+		if (other->children[i] == NULL) {
+			collectWords(node->children[i], word, removed);
+		} else if (node->children[i] == NULL) {
+			collectWords(other->children[i], word, added);
+		} else {
+			diffNodes(node->children[i], other->children[i], word, added, removed);
 		}
+		word.erase(word.length() - 1);
 	}
+}
 
-	return true;
+void Trie::collectWords(TrieNode* node, string& word, std::vector<string>& words) {
+	if (node->isLeaf) {
+		words.push_back(word);
+	}
+	for (int i = 0; i < 26; i++) {
+		if (node->children[i] != NULL) {
+			word.push_back(indexToChar(i));
+			collectWords(node->children[i], word, words);
+			word.erase(word.length() - 1);
+		}
+	}
 }
 
 TrieInfo Trie::getTrieInfo() {
 	TrieInfo info = TrieInfo();
-	info.trieSize += sizeof(*this);
+	info.trieSize += sizeof(root);
 #if DEBUG
-	info.trieSize -= sizeof(id);
 	info.trieSize -= sizeof(root.id);
 #endif
 
@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "BoardWalk.h"
+#include "Boggle.h"
+#include "LiveDictionary.h"
+#include "Logger.h"
+#include "NodePool.h"
+
+#define DICTFILE "BoggleWords.dict"
+#define TRIEFILE "BoggleWords.trie"
+#define BENCH_LOG "BoggleBenchmark.log"
+#define BENCH_BOARDS 2000u
+#define BENCH_SEED 1u
+#define PROFILE_TRIEFILE "BoggleWordsProfiled.trie"
+#define PROFILE_BOARDS 2000u
+#define PROFILE_SEED 1000000u	// profile corpus, disjoint from the timed boards
+
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+// helper functions
+double elapsedMs(steady_clock::time_point start);
+uint64_t hugePagesKb();
+int openCacheMissCounter();
+int64_t readCacheMissCounter(int counter);
+
+// benchmarks
+void benchEngine(Boggle& boggle, SolveEngine engine, const char* name, unsigned int boards, bool prefetch = true);
+void benchLayoutSize(int layout, const char* name);
+void benchPageMode(PageMode mode, unsigned int boards);
+void benchNodeOrder(const char* order, unsigned int boards);
+void benchHotSwap(unsigned int boards);
+void benchCompletions(size_t k);
+void benchEarlyExit(unsigned int boards, int minPoints);
+void benchDeadline(unsigned int boards, long deadlineUs);
+void benchScoreBound(unsigned int boards, int minPoints);
+
+int main(int argc, char** argv) {
+	unsigned int boards = BENCH_BOARDS;
+	if (argc > 1) {
+		boards = strtoul(argv[1], NULL, 10);
+	}
+
+	Logger::Instance()->openLogFile(BENCH_LOG, true);
+
+	{
+		LOG_INFO("Benchmarking solve engines");
+		Boggle boggle(DICTFILE, TRIEFILE, LAYOUT_POINTER | LAYOUT_COMPACT | LAYOUT_LOUDS);
+		benchEngine(boggle, ENGINE_BOARD, "board", boards);
+		benchEngine(boggle, ENGINE_ITERATIVE, "iterative", boards);
+		benchEngine(boggle, ENGINE_ITERATIVE, "iterative-noprefetch", boards, false);
+		benchEngine(boggle, ENGINE_COMPACT, "compact", boards);
+		benchEngine(boggle, ENGINE_COMPACT, "compact-noprefetch", boards, false);
+		benchEngine(boggle, ENGINE_LOUDS, "louds", boards);
+		benchEngine(boggle, ENGINE_DICT, "dict", boards);
+		benchEngine(boggle, ENGINE_AUTO, "auto", boards);
+	}
+
+	LOG_INFO("Benchmarking trie layout sizes");
+	benchLayoutSize(LAYOUT_POINTER, "pointer");
+	benchLayoutSize(LAYOUT_COMPACT, "compact");
+	benchLayoutSize(LAYOUT_LOUDS, "louds");
+
+	LOG_INFO("Benchmarking profiled trie node layout");
+	remove(PROFILE_TRIEFILE);
+	benchNodeOrder("bfs", boards);
+	{
+		Boggle boggle(DICTFILE, PROFILE_TRIEFILE, LAYOUT_POINTER);
+		boggle.profileLayout(PROFILE_BOARDS, PROFILE_SEED);
+	}
+	benchNodeOrder("profiled", boards);
+	remove(PROFILE_TRIEFILE);
+
+	LOG_INFO("Benchmarking live dictionary swap");
+	benchHotSwap(boards);
+
+	LOG_INFO("Benchmarking prefix completions");
+	benchCompletions(10);
+	benchCompletions(50);
+
+	LOG_INFO("Benchmarking early exit with the word iterator");
+	benchEarlyExit(boards, 100);
+	benchEarlyExit(boards, 1000);
+
+	LOG_INFO("Benchmarking deadline-bounded solves");
+	benchDeadline(boards, 25);
+	benchDeadline(boards, 50);
+	benchDeadline(boards, 100);
+
+	LOG_INFO("Benchmarking the score upper bound as a board filter");
+	benchScoreBound(boards, 200);
+	benchScoreBound(boards, 500);
+	benchScoreBound(boards, 1000);
+
+	LOG_INFO("Benchmarking trie page modes");
+	benchPageMode(PAGES_DEFAULT, boards);
+	benchPageMode(PAGES_TRANSPARENT, boards);
+	benchPageMode(PAGES_EXPLICIT, boards);
+
+	Logger::Instance()->closeLogFile();
+}
+
+/***********
+ * Helpers *
+ ***********/
+
+double elapsedMs(steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+uint64_t hugePagesKb() {
+	// transparent huge pages backing this process, as reported by the kernel
+	std::ifstream file("/proc/self/smaps_rollup");
+	std::string line;
+	while (getline(file, line)) {
+		if (line.compare(0, 14, "AnonHugePages:") == 0) {
+			return strtoull(line.c_str() + 14, NULL, 10);
+		}
+	}
+
+	return 0;
+}
+
+int openCacheMissCounter() {
+	// hardware cache misses of this thread, or -1 where perf is unavailable
+#ifdef __linux__
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	int counter = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (counter >= 0) {
+		ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	return counter;
+#else
+	return -1;
+#endif
+}
+
+int64_t readCacheMissCounter(int counter) {
+	int64_t misses = -1;
+	if (counter >= 0) {
+		if (read(counter, &misses, sizeof(misses)) != sizeof(misses)) { misses = -1; }
+		close(counter);
+	}
+
+	return misses;
+}
+
+/**************
+ * Benchmarks *
+ **************/
+
+void benchEngine(Boggle& boggle, SolveEngine engine, const char* name, unsigned int boards, bool prefetch) {
+	SolveOptions options;
+	options.engine = engine;
+	options.prefetch = prefetch;
+	options.listWords = false;
+	SolveResult result;
+	uint64_t points = 0;
+
+	steady_clock::time_point start = steady_clock::now();
+	for (unsigned int seed = BENCH_SEED; seed < BENCH_SEED + boards; seed++) {
+		boggle.newGame(seed);
+		boggle.solve(result, options);
+		points += result.points;
+	}
+	double solveMs = elapsedMs(start);
+
+	LOG_INFO("engine=%s boards=%u solve_us=%.2f points=%lu", name, boards, solveMs * 1000.0 / boards, points);
+}
+
+void benchPageMode(PageMode mode, unsigned int boards) {
+	NodePool::Instance()->setPageMode(mode);
+
+	steady_clock::time_point start = steady_clock::now();
+	Boggle boggle(DICTFILE, TRIEFILE);
+	double loadMs = elapsedMs(start);
+
+	SolveOptions options;
+	options.engine = ENGINE_ITERATIVE;
+	options.listWords = false;
+	SolveResult result;
+	uint64_t points = 0;
+
+	start = steady_clock::now();
+	for (unsigned int seed = BENCH_SEED; seed < BENCH_SEED + boards; seed++) {
+		boggle.newGame(seed);
+		boggle.solve(result, options);
+		points += result.points;
+	}
+	double solveMs = elapsedMs(start);
+
+	LOG_INFO("pages=%s granted=%s load_ms=%.1f boards=%u solve_us=%.2f points=%lu huge_kb=%lu mapped_kb=%lu",
+		pageModeName(mode), pageModeName(NodePool::Instance()->getGrantedPageMode()), loadMs, boards,
+		solveMs * 1000.0 / boards, points, hugePagesKb(), NodePool::Instance()->getMappedBytes() / 1024);
+}
+
+void benchLayoutSize(int layout, const char* name) {
+	Boggle boggle(DICTFILE, TRIEFILE, layout);
+	TrieInfo info = boggle.getTrieInfo();
+	LOG_INFO("layout=%s nodes=%lu bytes=%lu bits_per_node=%.1f", name, info.letterCount + 1, info.trieSize,
+		info.trieSize * 8.0 / (info.letterCount + 1));
+}
+
+void benchNodeOrder(const char* order, unsigned int boards) {
+	// fresh process-wide pool, so node placement follows the trie file
+	Boggle boggle(DICTFILE, PROFILE_TRIEFILE, LAYOUT_POINTER);
+	SolveOptions options;
+	options.engine = ENGINE_ITERATIVE;
+	options.listWords = false;
+	SolveResult result;
+	uint64_t points = 0;
+
+	int counter = openCacheMissCounter();
+	steady_clock::time_point start = steady_clock::now();
+	for (unsigned int seed = BENCH_SEED; seed < BENCH_SEED + boards; seed++) {
+		boggle.newGame(seed);
+		boggle.solve(result, options);
+		points += result.points;
+	}
+	double solveMs = elapsedMs(start);
+	int64_t misses = readCacheMissCounter(counter);
+
+	LOG_INFO("order=%s boards=%u solve_us=%.2f cache_misses_per_board=%.0f points=%lu", order, boards,
+		solveMs * 1000.0 / boards, (misses >= 0) ? (double)misses / boards : -1.0, points);
+}
+
+void benchHotSwap(unsigned int boards) {
+	LiveDictionary live(DICTFILE, TRIEFILE);
+	SolveOptions options;
+	options.listWords = false;
+	SolveResult result;
+
+	// reader overhead: the same boards through a DictionaryReader and directly
+	{
+		DictionaryReader reader(live);
+		Boggle& direct = reader.begin();
+		reader.end();
+
+		steady_clock::time_point start = steady_clock::now();
+		for (unsigned int seed = BENCH_SEED; seed < BENCH_SEED + boards; seed++) {
+			direct.newGame(seed);
+			direct.solve(result, options);
+		}
+		double directMs = elapsedMs(start);
+
+		start = steady_clock::now();
+		for (unsigned int seed = BENCH_SEED; seed < BENCH_SEED + boards; seed++) {
+			Boggle& boggle = reader.begin();
+			boggle.newGame(seed);
+			boggle.solve(result, options);
+			reader.end();
+		}
+		double readerMs = elapsedMs(start);
+
+		const unsigned int sections = 1000000;
+		start = steady_clock::now();
+		for (unsigned int s = 0; s < sections; s++) {
+			reader.begin();
+			reader.end();
+		}
+		double sectionMs = elapsedMs(start);
+
+		LOG_INFO("swap=reader boards=%u direct_us=%.2f reader_us=%.2f section_ns=%.1f", boards,
+			directMs * 1000.0 / boards, readerMs * 1000.0 / boards, sectionMs * 1000000.0 / sections);
+	}
+
+	// swap latency under load: publish, then grace period until the old snapshot is freed
+	std::atomic<bool> stop(false);
+	std::atomic<uint64_t> solved(0);
+	std::thread solver([&live, &stop, &solved]() {
+		DictionaryReader reader(live);
+		SolveOptions options;
+		options.listWords = false;
+		SolveResult result;
+		for (unsigned int seed = BENCH_SEED; !stop.load(); seed++) {
+			Boggle& boggle = reader.begin();
+			boggle.newGame(seed);
+			boggle.solve(result, options);
+			reader.end();
+			solved++;
+		}
+	});
+	steady_clock::time_point start = steady_clock::now();
+	live.reload(DICTFILE, TRIEFILE);
+	double reloadMs = elapsedMs(start);
+	start = steady_clock::now();
+	while (!live.reclaim()) {
+		std::this_thread::yield();
+	}
+	double graceMs = elapsedMs(start);
+	stop.store(true);
+	solver.join();
+
+	LOG_INFO("swap=reload reload_ms=%.1f grace_ms=%.3f boards_during=%lu", reloadMs, graceMs, solved.load());
+}
+
+void benchCompletions(size_t k) {
+	Boggle boggle(DICTFILE, TRIEFILE, LAYOUT_COMPACT);
+	steady_clock::time_point start = steady_clock::now();
+	boggle.loadCompletions(RANK_POINTS);
+	double buildMs = elapsedMs(start);
+
+	// every one, two and three letter prefix; k above COMPLETION_CACHE_K bypasses the caches
+	std::vector<string> prefixes;
+	for (char a = 'A'; a <= 'Z'; a++) {
+		prefixes.push_back(string(1, a));
+		for (char b = 'A'; b <= 'Z'; b++) {
+			prefixes.push_back(string(1, a) + b);
+			for (char c = 'A'; c <= 'Z'; c++) {
+				prefixes.push_back(string(1, a) + b + c);
+			}
+		}
+	}
+
+	std::vector<string> words;
+	uint64_t completions = 0;
+	start = steady_clock::now();
+	for (size_t p = 0; p < prefixes.size(); p++) {
+		boggle.complete(prefixes[p], k, words);
+		completions += words.size();
+	}
+	double queryMs = elapsedMs(start);
+
+	LOG_INFO("complete=%lu build_ms=%.1f queries=%lu completions=%lu qps=%.0f", k, buildMs,
+		prefixes.size(), completions, prefixes.size() * 1000.0 / queryMs);
+}
+
+void benchEarlyExit(unsigned int boards, int minPoints) {
+	// "does the board score at least minPoints", by full solve and by iterator
+	Boggle boggle(DICTFILE, TRIEFILE, LAYOUT_COMPACT);
+	WordIterator iterator(boggle);
+	SolveOptions options;
+	options.listWords = false;
+	SolveResult result;
+	unsigned int solvedPass = 0, iteratedPass = 0;
+
+	steady_clock::time_point start = steady_clock::now();
+	for (unsigned int seed = BENCH_SEED; seed < BENCH_SEED + boards; seed++) {
+		boggle.newGame(seed);
+		boggle.solve(result, options);
+		if (result.points >= minPoints) { solvedPass++; }
+	}
+	double solveMs = elapsedMs(start);
+
+	start = steady_clock::now();
+	for (unsigned int seed = BENCH_SEED; seed < BENCH_SEED + boards; seed++) {
+		boggle.newGame(seed);
+		iterator.reset();
+		uint32_t wordId;
+		int len;
+		while ((iterator.getPoints() < minPoints) && iterator.next(wordId, len)) { }
+		if (iterator.getPoints() >= minPoints) { iteratedPass++; }
+	}
+	double iterateMs = elapsedMs(start);
+
+	LOG_INFO("early_exit=points>=%d boards=%u pass=%u/%u solve_us=%.2f iterate_us=%.2f", minPoints, boards,
+		iteratedPass, solvedPass, solveMs * 1000.0 / boards, iterateMs * 1000.0 / boards);
+}
+
+void benchDeadline(unsigned int boards, long deadlineUs) {
+	// share of each board's points a deadline keeps, and how far past it solves return
+	Boggle boggle(DICTFILE, TRIEFILE, LAYOUT_DEFAULT);
+	SolveOptions options;
+	options.listWords = false;
+	SolveResult full, bounded;
+	uint64_t fullPoints = 0, boundedPoints = 0;
+	unsigned int partial = 0;
+	double overrunUs = 0.0, worstUs = 0.0;
+
+	for (unsigned int seed = BENCH_SEED; seed < BENCH_SEED + boards; seed++) {
+		boggle.newGame(seed);
+		options.deadline = steady_clock::time_point::max();
+		boggle.solve(full, options);
+
+		steady_clock::time_point start = steady_clock::now();
+		options.deadline = start + microseconds(deadlineUs);
+		boggle.solve(bounded, options);
+		double overrun = elapsedMs(start) * 1000.0 - deadlineUs;
+
+		fullPoints += full.points;
+		boundedPoints += bounded.points;
+		if (!bounded.complete) {
+			partial++;
+			overrunUs += overrun;
+			worstUs = std::max(worstUs, overrun);
+		}
+	}
+
+	LOG_INFO("deadline_us=%ld boards=%u partial=%u points_kept=%.1f%% mean_overrun_us=%.2f max_overrun_us=%.2f",
+		deadlineUs, boards, partial, 100.0 * boundedPoints / fullPoints,
+		(partial > 0) ? overrunUs / partial : 0.0, worstUs);
+}
+
+void benchScoreBound(unsigned int boards, int minPoints) {
+	// boards the bound rejects against those below minPoints, and the cost of each filter
+	Boggle boggle(DICTFILE, TRIEFILE, LAYOUT_DEFAULT);
+	SolveOptions options;
+	options.listWords = false;
+	SolveResult result;
+	unsigned int rejected = 0, below = 0, unsound = 0;
+	double boundMs = 0.0, solveMs = 0.0, survivorMs = 0.0;
+
+	for (unsigned int seed = BENCH_SEED; seed < BENCH_SEED + boards; seed++) {
+		boggle.newGame(seed);
+		steady_clock::time_point start = steady_clock::now();
+		int bound = boggle.scoreBound();
+		boundMs += elapsedMs(start);
+
+		start = steady_clock::now();
+		boggle.solve(result, options);
+		double ms = elapsedMs(start);
+		solveMs += ms;
+
+		if (bound < minPoints) {
+			rejected++;
+		} else {
+			survivorMs += ms;
+		}
+		if (result.points < minPoints) { below++; }
+		if (bound < result.points) { unsound++; }
+	}
+
+	LOG_INFO("score_bound=points>=%d boards=%u rejected=%u below=%u unsound=%u bound_us=%.2f solve_us=%.2f "
+		"filtered_us=%.2f", minPoints, boards, rejected, below, unsound, boundMs * 1000.0 / boards,
+		solveMs * 1000.0 / boards, (boundMs + survivorMs) * 1000.0 / boards);
+}
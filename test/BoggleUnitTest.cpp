@@ -1,12 +1,31 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cinttypes>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <regex>
+#include <set>
+#include <signal.h>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
+#include "BoardWalk.h"
 #include "Boggle.h"
+#include "BoggleApi.h"
+#include "DiceSet.h"
+#include "LiveDictionary.h"
 #include "Logger.h"
+#include "ResultWriter.h"
+#include "Simulation.h"
+#include "Supervisor.h"
 
 #define DICTFILE "BoggleWords.dict"
 #define TEST_DICTFILE "TestBoggleWords.dict"
@@ -17,13 +36,27 @@
 #define TEST_LETTERCOUNT 22u
 #define TEST_WORDCOUNT 7u
 #define TEST_NODECOUNT 23u
-#define TEST_TRIESIZEBYTES 4968u
+#define TEST_TRIESIZEBYTES 5152u
 #define BUFFERINC (sizeof(uint32_t))
 #define BUFFERSIZE (BUFFERINC * TEST_NODECOUNT)
+#define TEST_SEEDCOUNT 200u
+#define TEST_CHECKPOINT "TestSimulation.ckpt"
+#define TEST_WEIGHTS "TestWeights.txt"
+#define TEST_DICE "TestDice.txt"
+#define TEST_OVERLAY "TestOverlay.dict"
+#define TEST_COMPACT "TestBoggleWords.ctrie"
+#define TEST_CORRUPT "TestCorrupt.ctrie"
+#define TEST_STDOUT "TestStdout.out"
+#define TEST_APILOG "TestApi.log"
+#define TEST_OTHERDICT "TestOtherWords.dict"
+#define TEST_OTHERTRIE "TestOtherWords.trie"
+#define TEST_LOUDSBITS 18		// LOUDS bits per node on the default dictionary
+#define TEST_CRASHSEED 13u		// board a CrashingSupervisor's workers die on
 
 using std::ios;
 using std::ifstream;
 using std::ofstream;
+using std::vector;
 
 // serializer word list
 static string words[TEST_WORDCOUNT] = {
@@ -60,9 +93,13 @@ static uint32_t fileUints[TEST_NODECOUNT] = {
 	0x00200000,	// 0E
 	0x80000000	// 1
 };
+// serializer file trailer: root hash and magic
+static uint64_t fileHash = 0x0bcef01d8f7e8277ull;
+static uint32_t fileHashMagic = TRIE_HASH_MAGIC;
 
 // helper functions
 bool compareDictFiles(const char* fileName, const char* testFileName);
+bool compareResults(SolveResult& result, SolveResult& testResult);
 bool loadTrie(Trie& dictTrie, char const* fileName);
 void removeTestFiles();
 void writeWord(TrieNode* node, ofstream& file, string word);
@@ -73,6 +110,27 @@ bool testDeserializer(const char* testFileName);
 bool testTrieInfo();
 bool testTrieFromDict(const char* dictFileName, const char* testDictFileName);
 bool testTrieFromFile(const char* dictFileName, const char* testDictFileName, const char* testTrieFileName);
+bool testTrieHash(const char* dictFileName, const char* testTrieFileName);
+bool testSolveEngines(const char* dictFileName, const char* testTrieFileName);
+bool testDefaultDictionary(const char* dictFileName, const char* testTrieFileName);
+bool testLoudsTrie(const char* dictFileName, const char* testTrieFileName);
+bool testTrieLayout(const char* dictFileName, const char* testTrieFileName);
+bool testSimulation(const char* dictFileName, const char* testTrieFileName);
+bool testScoreRound(const char* dictFileName, const char* testTrieFileName);
+bool testDictJournal(const char* dictFileName, const char* testTrieFileName);
+bool testLiveDictionary(const char* dictFileName, const char* testTrieFileName);
+bool testCompletions(const char* dictFileName, const char* testTrieFileName);
+bool testPatternSearch(const char* dictFileName, const char* testTrieFileName);
+bool testDiceFilter();
+bool testQuCells(const char* dictFileName, const char* testTrieFileName);
+bool testWordIterator(const char* dictFileName, const char* testTrieFileName);
+bool testSolveDeadline(const char* dictFileName, const char* testTrieFileName);
+bool testSupervisor(const char* dictFileName, const char* testTrieFileName);
+bool testOverlayDicts(const char* dictFileName, const char* testTrieFileName);
+bool testScoreBound(const char* dictFileName, const char* testTrieFileName);
+bool testWordPaths(const char* dictFileName, const char* testTrieFileName);
+bool testCApi(const char* dictFileName, const char* testTrieFileName);
+bool testConsoleOutput(const char* dictFileName, const char* testTrieFileName);
 
 // analytics
 void runAnalytics();
@@ -113,6 +171,132 @@ int main(int argc, char** argv) {
 
 	removeTestFiles();
 
+	LOG_INFO("Testing trie hashes");
+	ret = testTrieHash(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Trie hash test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing solve engines");
+	ret = testSolveEngines(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Solve engines test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing default dictionary");
+	ret = testDefaultDictionary(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Default dictionary test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing LOUDS trie");
+	ret = testLoudsTrie(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("LOUDS trie test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing profiled trie layout");
+	ret = testTrieLayout(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Profiled trie layout test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing board simulation");
+	ret = testSimulation(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Board simulation test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing round scoring");
+	ret = testScoreRound(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Round scoring test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing dictionary journal");
+	ret = testDictJournal(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Dictionary journal test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing live dictionary swap");
+	ret = testLiveDictionary(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Live dictionary swap test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing prefix completions");
+	ret = testCompletions(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Prefix completions test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing pattern search");
+	ret = testPatternSearch(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Pattern search test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing dice dictionary filter");
+	ret = testDiceFilter();
+	LOG_INFO("Dice dictionary filter test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing Qu cells");
+	ret = testQuCells(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Qu cells test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing word iterator");
+	ret = testWordIterator(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Word iterator test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing deadline-bounded solves");
+	ret = testSolveDeadline(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Solve deadline test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing prefork supervisor");
+	ret = testSupervisor(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Prefork supervisor test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing overlay dictionaries");
+	ret = testOverlayDicts(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Overlay dictionaries test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing score upper bound");
+	ret = testScoreBound(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Score upper bound test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing word paths");
+	ret = testWordPaths(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Word paths test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing C API");
+	ret = testCApi(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("C API test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
+	LOG_INFO("Testing console output");
+	ret = testConsoleOutput(DICTFILE, TEST_DICTTRIE);
+	LOG_INFO("Console output test: %s", ret ? "PASS" : "FAIL");
+
+	removeTestFiles();
+
 	Logger::Instance()->closeLogFile();
 }
 
@@ -164,6 +348,25 @@ bool compareDictFiles(const char* fileName, const char* testFileName) {
 	return true;
 }
 
+bool compareResults(SolveResult& result, SolveResult& testResult) {
+	if (result.points != testResult.points) {
+		LOG_INFO("Points: %d != %d", result.points, testResult.points);
+		return false;
+	}
+	for (int i = 0; i < WORD_COUNTS; i++) {
+		if (result.wordCounts[i] != testResult.wordCounts[i]) {
+			LOG_INFO("%d-letter words: %d != %d", i + MIN_WORD_LENGTH, result.wordCounts[i], testResult.wordCounts[i]);
+			return false;
+		}
+	}
+	if (result.words != testResult.words) {
+		LOG_INFO("Word lists differ");
+		return false;
+	}
+
+	return true;
+}
+
 bool loadTrie(Trie& dictTrie, char const* fileName) {
 	dictTrie = Trie();
 	ifstream fileIn;
@@ -188,6 +391,17 @@ void removeTestFiles() {
 	remove(TEST_DICTTRIE);
 	remove(TEST_TRIE);
 	remove(TEST_STATICTRIE);
+	remove(TEST_CHECKPOINT);
+	remove(TEST_DICTTRIE JOURNAL_SUFFIX);
+	remove(TEST_WEIGHTS);
+	remove(TEST_DICE);
+	remove(TEST_OVERLAY);
+	remove(TEST_COMPACT);
+	remove(TEST_CORRUPT);
+	remove(TEST_STDOUT);
+	remove(TEST_APILOG);
+	remove(TEST_OTHERDICT);
+	remove(TEST_OTHERTRIE);
 }
 
 void writeWord(TrieNode* node, ofstream& file, string word) {
@@ -219,6 +433,8 @@ bool testSerializer(const char* testFileName, const char* testStaticFileName) {
 		std::memcpy(&buffer[i*BUFFERINC], &fileUints[i], BUFFERINC);
 	}
 	file.write(buffer, BUFFERSIZE);
+	file.write((const char*)&fileHash, sizeof(fileHash));
+	file.write((const char*)&fileHashMagic, sizeof(fileHashMagic));
 	file.close();
 
 	// create trie
@@ -268,6 +484,8 @@ bool testDeserializer(const char* testStaticFileName) {
 		std::memcpy(&buffer[i*BUFFERINC], &fileUints[i], BUFFERINC);
 	}
 	file.write(buffer, BUFFERSIZE);
+	file.write((const char*)&fileHash, sizeof(fileHash));
+	file.write((const char*)&fileHashMagic, sizeof(fileHashMagic));
 	file.close();
 
 	// create static trie
@@ -360,3 +578,1206 @@ bool testTrieFromFile(const char* dictFileName, const char* testDictFileName, co
 
 	return compareDictFiles(dictFileName, testDictFileName);
 }
+
+bool testTrieHash(const char* dictFileName, const char* testTrieFileName) {
+	Trie dictTrie, editedTrie;
+	if (!loadTrie(dictTrie, dictFileName) || !loadTrie(editedTrie, dictFileName)) {
+		return false;
+	}
+	if (!dictTrie.trieCompare(editedTrie)) {
+		return false;
+	}
+
+	// the diff reports exactly the edits, in word order
+	const char* removedWords[] = { "AAHED", "QUIZ", "ZYZZYVA" };
+	const char* addedWords[] = { "BOGGLEWORD", "QUIZZICALLYX" };
+	for (int w = 0; w < 3; w++) {
+		if (!editedTrie.erase(removedWords[w], strlen(removedWords[w]))) { return false; }
+	}
+	for (int w = 0; w < 2; w++) {
+		editedTrie.insert(addedWords[w], strlen(addedWords[w]));
+	}
+	vector<string> added, removed;
+	dictTrie.diff(editedTrie, added, removed);
+	if ((dictTrie.trieCompare(editedTrie)) || (added != vector<string>(addedWords, addedWords + 2)) ||
+			(removed != vector<string>(removedWords, removedWords + 3))) {
+		LOG_INFO("Diff found %lu added and %lu removed words", added.size(), removed.size());
+		return false;
+	}
+
+	// undoing the edits restores the hash, whatever the order
+	for (int w = 2; w >= 0; w--) {
+		editedTrie.insert(removedWords[w], strlen(removedWords[w]));
+	}
+	for (int w = 0; w < 2; w++) {
+		editedTrie.erase(addedWords[w], strlen(addedWords[w]));
+	}
+	if (!dictTrie.trieCompare(editedTrie)) {
+		return false;
+	}
+
+	// the file carries the root hash, and a load that disagrees with it fails
+	uint64_t fileHash;
+	if (!dictTrie.serialize(testTrieFileName) || !Trie::readFileHash(testTrieFileName, fileHash) ||
+			(fileHash != dictTrie.getHash())) {
+		return false;
+	}
+	std::fstream file(testTrieFileName, ios::in | ios::out | ios::binary);
+	uint32_t mask;
+	file.seekg(1000 * sizeof(mask));
+	file.read((char*)&mask, sizeof(mask));
+	mask ^= 0x80000000u;	// leaf bit
+	file.seekp(1000 * sizeof(mask));
+	file.write((const char*)&mask, sizeof(mask));
+	file.close();
+
+	return !editedTrie.deserialize(testTrieFileName);
+}
+
+bool testSolveEngines(const char* dictFileName, const char* testTrieFileName) {
+	Boggle boggle(dictFileName, testTrieFileName);
+	int dictCount = 0;
+
+	// differential test over a seeded board corpus
+	for (unsigned int seed = 0; seed < TEST_SEEDCOUNT; seed++) {
+		SolveResult boardResult, dictResult, iterativeResult, compactResult, autoResult;
+		boggle.newGame(seed);
+		boggle.solve(boardResult, ENGINE_BOARD);
+		boggle.solve(dictResult, ENGINE_DICT);
+		boggle.solve(iterativeResult, ENGINE_ITERATIVE);
+		boggle.solve(compactResult, ENGINE_COMPACT);
+		boggle.solve(autoResult);
+
+		if (!compareResults(boardResult, dictResult) || !compareResults(boardResult, iterativeResult)
+			|| !compareResults(boardResult, compactResult) || !compareResults(boardResult, autoResult)) {
+			LOG_INFO("Engines disagree on board with seed %u", seed);
+			return false;
+		}
+		if (autoResult.engine == ENGINE_DICT) { dictCount++; }
+	}
+	LOG_INFO("Dictionary engine selected for %d of %u boards", dictCount, TEST_SEEDCOUNT);
+
+	return true;
+}
+
+bool testLoudsTrie(const char* dictFileName, const char* testTrieFileName) {
+	Boggle boggle(dictFileName, testTrieFileName);
+	Boggle loudsBoggle(dictFileName, testTrieFileName, LAYOUT_LOUDS);
+	if (loudsBoggle.getLayouts() != LAYOUT_LOUDS) {
+		return false;
+	}
+
+	TrieInfo info = boggle.getTrieInfo(), loudsInfo = loudsBoggle.getTrieInfo();
+	LOG_INFO("LOUDS trie: %lu words, %lu B (%.1f bits per node)", loudsInfo.wordCount, loudsInfo.trieSize,
+		loudsInfo.trieSize * 8.0 / (loudsInfo.letterCount + 1));
+	if ((info.wordCount != loudsInfo.wordCount) || (info.letterCount != loudsInfo.letterCount)) {
+		return false;
+	}
+	// tree, leaf and label bits plus the word IDs; see LoudsTrie
+	if (loudsInfo.trieSize * 8.0 / (loudsInfo.letterCount + 1) > TEST_LOUDSBITS) {
+		LOG_INFO("LOUDS trie is over %d bits per node", TEST_LOUDSBITS);
+		return false;
+	}
+
+	// every word ID leads back to its word without an inverse array
+	string word, loudsWord;
+	for (uint32_t wordId = 0; wordId < info.wordCount; wordId++) {
+		if (!boggle.getWord(wordId, word) || !loudsBoggle.getWord(wordId, loudsWord) || (word != loudsWord)) {
+			LOG_INFO("LOUDS trie spells word %u '%s', expected '%s'", wordId, loudsWord.c_str(), word.c_str());
+			return false;
+		}
+	}
+	if (loudsBoggle.getWord(info.wordCount, loudsWord)) {
+		return false;
+	}
+
+	// the LOUDS-only instance must report the same IDs and rebuild the same words
+	for (unsigned int seed = 0; seed < TEST_SEEDCOUNT; seed++) {
+		SolveResult result, loudsResult;
+		boggle.newGame(seed);
+		loudsBoggle.newGame(seed);
+		boggle.solve(result, ENGINE_COMPACT);
+		loudsBoggle.solve(loudsResult);
+
+		if ((loudsResult.engine != ENGINE_LOUDS) || !compareResults(result, loudsResult)
+			|| (result.wordIds != loudsResult.wordIds)) {
+			LOG_INFO("LOUDS trie disagrees on board with seed %u", seed);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool testTrieLayout(const char* dictFileName, const char* testTrieFileName) {
+	SolveResult before[TEST_SEEDCOUNT];
+	{
+		Boggle boggle(dictFileName, testTrieFileName, LAYOUT_POINTER);
+		for (unsigned int seed = 0; seed < TEST_SEEDCOUNT; seed++) {
+			boggle.newGame(seed);
+			boggle.solve(before[seed], ENGINE_BOARD);
+		}
+		if (!boggle.profileLayout(TEST_SEEDCOUNT, TEST_SEEDCOUNT)) {
+			return false;
+		}
+	}
+
+	// the layout trailer must round trip without changing the trie itself
+	Trie plainTrie, layoutTrie;
+	if (!loadTrie(plainTrie, dictFileName) || !layoutTrie.deserialize(testTrieFileName)) {
+		return false;
+	}
+	TrieInfo info = layoutTrie.getTrieInfo();
+	if ((layoutTrie.getLayout().size() != info.letterCount + 1) || !layoutTrie.trieCompare(plainTrie)) {
+		return false;
+	}
+	plainTrie.clearTrie();
+	layoutTrie.clearTrie();
+
+	// and every layout reads the rewritten file
+	Boggle boggle(dictFileName, testTrieFileName, LAYOUT_POINTER | LAYOUT_LOUDS);
+	for (unsigned int seed = 0; seed < TEST_SEEDCOUNT; seed++) {
+		SolveResult pointerResult, loudsResult;
+		boggle.newGame(seed);
+		boggle.solve(pointerResult, ENGINE_BOARD);
+		boggle.solve(loudsResult, ENGINE_LOUDS);
+		if (!compareResults(before[seed], pointerResult) || !compareResults(before[seed], loudsResult)) {
+			LOG_INFO("Profiled layout changed the result for seed %u", seed);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool testSimulation(const char* dictFileName, const char* testTrieFileName) {
+	Boggle boggle(dictFileName, testTrieFileName);
+
+	// reference totals, one board at a time
+	BoardStats expected;
+	expected.clear(1, boggle.getTrieInfo().wordCount, boggle.getDictionaryHash());
+	for (unsigned int seed = 1; seed < TEST_SEEDCOUNT + 1; seed++) {
+		SolveResult result;
+		boggle.newGame(seed);
+		boggle.solve(result);
+		expected.add(result);
+	}
+
+	// threaded, stopped halfway and resumed from the checkpoint
+	Simulation simulation(boggle, 3);
+	BoardStats first, resumed;
+	if (!simulation.run(TEST_SEEDCOUNT / 2, 1, TEST_CHECKPOINT, first) || (first.boards != TEST_SEEDCOUNT / 2)) {
+		return false;
+	}
+	if (!simulation.run(TEST_SEEDCOUNT, 1, TEST_CHECKPOINT, resumed)) {
+		return false;
+	}
+
+	bool ret = (resumed.boards == expected.boards) && (resumed.scores == expected.scores)
+		&& (resumed.wordFrequency == expected.wordFrequency);
+	for (int i = 0; i < WORD_COUNTS; i++) {
+		if (resumed.wordCounts[i] != expected.wordCounts[i]) { ret = false; }
+	}
+
+	// as many words, one of them different: the checkpoint isn't resumed
+	{
+		ifstream words(dictFileName);
+		ofstream otherWords(TEST_OTHERDICT, ios::out | ios::trunc);
+		string word;
+		getline(words, word);
+		otherWords << "QZXJV" << std::endl;
+		while (getline(words, word)) {
+			otherWords << word << std::endl;
+		}
+	}
+	Boggle other(TEST_OTHERDICT, TEST_OTHERTRIE);
+	Simulation otherSimulation(other, 1);
+	BoardStats rejected;
+	if ((other.getTrieInfo().wordCount != expected.wordFrequency.size())
+			|| otherSimulation.run(TEST_SEEDCOUNT * 2, 1, TEST_CHECKPOINT, rejected)) {
+		LOG_INFO("Checkpoint resumed over another dictionary");
+		ret = false;
+	}
+
+	// threads share a compact-only or LOUDS-only source in place, and a
+	// pointer-only one through a compact layout built once on the source;
+	// each hashes its dictionary the same
+	int layouts[] = { LAYOUT_COMPACT, LAYOUT_LOUDS, LAYOUT_POINTER };
+	for (int l = 0; (l < 3) && ret; l++) {
+		Boggle source(dictFileName, testTrieFileName, layouts[l]);
+		Simulation shared(source, 3);
+		BoardStats stats;
+		ret = shared.run(TEST_SEEDCOUNT, 1, NULL, stats) && (stats.scores == expected.scores)
+			&& (stats.wordFrequency == expected.wordFrequency) && (stats.dictionaryHash == expected.dictionaryHash);
+		if ((layouts[l] == LAYOUT_POINTER) && (source.getLayouts() != (LAYOUT_POINTER | LAYOUT_COMPACT))) {
+			ret = false;
+		}
+	}
+
+	return ret;
+}
+
+bool testScoreRound(const char* dictFileName, const char* testTrieFileName) {
+	Boggle boggle(dictFileName, testTrieFileName);
+	boggle.newGame(3);
+
+	// four-letter words on the board score one point each
+	SolveResult result;
+	boggle.solve(result);
+	vector<string> four;
+	for (size_t i = 0; i < result.words.size(); i++) {
+		if (result.words[i].length() == 4) { four.push_back(result.words[i]); }
+	}
+	if (four.size() < 4) {
+		return false;
+	}
+	string lower = four[1];
+	for (size_t i = 0; i < lower.length(); i++) { lower[i] = tolower(lower[i]); }
+
+	// words 1 and 2 are shared and score for nobody
+	vector<vector<string> > submissions(3);
+	submissions[0].push_back(four[0]);
+	submissions[0].push_back(four[1]);
+	submissions[0].push_back(four[2]);
+	submissions[0].push_back("ZZZZQ");
+	submissions[0].push_back(four[0]);
+	submissions[1].push_back(lower);
+	submissions[1].push_back(four[3]);
+	submissions[2].push_back(four[2]);
+	submissions[2].push_back("AB");
+
+	vector<PlayerScore> scores;
+	boggle.scoreRound(submissions, scores);
+	const int expected[3][4] = { { 1, 3, 1, 1 }, { 1, 2, 1, 0 }, { 0, 1, 0, 1 } };
+	for (int p = 0; p < 3; p++) {
+		LOG_INFO("Player %d: points = %d, words = %d, unique = %d, invalid = %d",
+			p, scores[p].points, scores[p].words, scores[p].unique, scores[p].invalid);
+		if ((scores[p].points != expected[p][0]) || (scores[p].words != expected[p][1])
+			|| (scores[p].unique != expected[p][2]) || (scores[p].invalid != expected[p][3])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool testDictJournal(const char* dictFileName, const char* testTrieFileName) {
+	const string added = "QZXJV";
+	SolveResult before, after;
+	uint32_t wordId;
+	string removed;
+	{
+		Boggle boggle(dictFileName, testTrieFileName, LAYOUT_DEFAULT | LAYOUT_LOUDS);
+		uint64_t letters = boggle.getTrieInfo().letterCount;
+		boggle.newGame(3);
+		boggle.solve(before);
+		for (size_t i = 0; (i < before.words.size()) && removed.empty(); i++) {
+			if (before.words[i].length() == 4) { removed = before.words[i]; }
+		}
+
+		// an added word's new nodes are pruned again when it is erased
+		if (!boggle.addWord(added) || !boggle.getWordId(added, wordId) || !boggle.removeWord(added)
+			|| (boggle.getTrieInfo().letterCount != letters) || boggle.removeWord(added)) {
+			return false;
+		}
+		if (!boggle.addWord(added) || !boggle.removeWord(removed)) {
+			return false;
+		}
+		boggle.solve(after);
+		if ((after.points != before.points - 1) || boggle.getWordId(removed, wordId)) {
+			return false;
+		}
+	}
+
+	// replayed on load, then folded into the trie file
+	for (int pass = 0; pass < 2; pass++) {
+		Boggle boggle(dictFileName, testTrieFileName, LAYOUT_DEFAULT | LAYOUT_LOUDS);
+		SolveResult compactResult, loudsResult;
+		boggle.newGame(3);
+		boggle.solve(compactResult, ENGINE_COMPACT);
+		boggle.solve(loudsResult, ENGINE_LOUDS);
+		if (!compareResults(after, compactResult) || !compareResults(after, loudsResult)
+			|| !boggle.getWordId(added, wordId) || boggle.getWordId(removed, wordId)) {
+			LOG_INFO("Dictionary edits lost on pass %d", pass);
+			return false;
+		}
+		if ((pass == 0) && !boggle.compactJournal(true)) {
+			return false;
+		}
+	}
+
+	ifstream journal(TEST_DICTTRIE JOURNAL_SUFFIX, ios::in | ios::ate);
+	if (!journal.is_open() || (journal.tellg() != 0)) {
+		return false;
+	}
+	journal.close();
+
+	// a word on nodes already in the trie keeps the node count, yet the
+	// profiled layout no longer describes the compacted trie
+	{
+		Boggle boggle(dictFileName, testTrieFileName, LAYOUT_POINTER);
+		if (!boggle.profileLayout(TEST_SEEDCOUNT, 0) || !boggle.addWord("QUALI") || !boggle.compactJournal(true)) {
+			return false;
+		}
+	}
+	Trie compacted;
+	if (!compacted.deserialize(testTrieFileName) || !compacted.getLayout().empty()) {
+		LOG_INFO("Compaction kept a stale node layout");
+		return false;
+	}
+
+	return true;
+}
+
+bool testLiveDictionary(const char* dictFileName, const char* testTrieFileName) {
+	LiveDictionary live(dictFileName, testTrieFileName);
+	DictionaryReader reader(live);
+	SolveResult expected, result;
+	reader.begin().newGame(5);
+	reader.begin().solve(expected);
+	reader.end();
+
+	// a snapshot in use survives the swap and is only reclaimed after end()
+	Boggle& pinned = reader.begin();
+	if (!live.reload(dictFileName, testTrieFileName) || (live.getGeneration() != 2) || live.reclaim()) {
+		return false;
+	}
+	pinned.solve(result);
+	reader.end();
+	if (!compareResults(expected, result) || !live.reclaim()) {
+		return false;
+	}
+
+	// readers keep solving on other threads through background swaps
+	std::atomic<bool> stop(false), ok(true);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 2; t++) {
+		threads.push_back(std::thread([&live, &expected, &stop, &ok]() {
+			DictionaryReader threadReader(live);
+			SolveResult threadResult;
+			while (!stop.load()) {
+				Boggle& boggle = threadReader.begin();
+				boggle.newGame(5);
+				boggle.solve(threadResult);
+				threadReader.end();
+				if (!compareResults(expected, threadResult)) { ok.store(false); }
+			}
+		}));
+	}
+	for (int swap = 0; swap < 3; swap++) {
+		if (!live.startReload(dictFileName, testTrieFileName) || !live.waitReload()) { ok.store(false); }
+	}
+	stop.store(true);
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+
+	if (!ok.load() || (live.getGeneration() != 5) || !live.reclaim()) {
+		return false;
+	}
+
+	// a reader past MAX_READERS has no slot, and still pins its snapshot
+	std::vector<DictionaryReader*> readers;
+	for (int r = 1; r < MAX_READERS; r++) {
+		readers.push_back(new DictionaryReader(live));
+	}
+	DictionaryReader overflow(live);
+	bool ret = !overflow.isRegistered();
+	Boggle& overflowPinned = overflow.begin();
+	if (!live.reload(dictFileName, testTrieFileName) || live.reclaim()) {
+		ret = false;
+	}
+	overflowPinned.newGame(5);
+	overflowPinned.solve(result);
+	overflow.end();
+	ret = ret && compareResults(expected, result) && live.reclaim();
+	for (size_t r = 0; r < readers.size(); r++) {
+		delete readers[r];
+	}
+
+	return ret;
+}
+
+bool testCompletions(const char* dictFileName, const char* testTrieFileName) {
+	Boggle boggle(dictFileName, testTrieFileName);
+	if (!boggle.loadCompletions(RANK_POINTS)) {
+		return false;
+	}
+
+	// brute force: every word, ranked by points, then length, then alphabetically
+	uint32_t wordCount = boggle.getTrieInfo().wordCount;
+	vector<string> all(wordCount);
+	for (uint32_t id = 0; id < wordCount; id++) {
+		boggle.getWord(id, all[id]);
+	}
+
+	// the root and "CO" are served from caches when k is small
+	const char* prefixes[] = { "", "CO", "QUI", "XYLOPHONE", "ZZQ" };
+	const size_t counts[] = { 5, 40 };
+	for (int p = 0; p < 5; p++) {
+		string prefix = prefixes[p];
+		vector<uint32_t> ranked;
+		for (uint32_t id = 0; id < wordCount; id++) {
+			if (all[id].compare(0, prefix.length(), prefix) == 0) { ranked.push_back(id); }
+		}
+		std::stable_sort(ranked.begin(), ranked.end(), [&all](uint32_t a, uint32_t b) {
+			int lenA = all[a].length(), lenB = all[b].length();
+			int weightA = Boggle::wordPoints(lenA) * 32 + lenA, weightB = Boggle::wordPoints(lenB) * 32 + lenB;
+			return weightA > weightB;
+		});
+
+		for (int c = 0; c < 2; c++) {
+			vector<string> completions;
+			uint32_t total = boggle.complete(prefix, counts[c], completions);
+			if ((total != ranked.size()) || (completions.size() != std::min(counts[c], ranked.size()))) {
+				LOG_INFO("Prefix '%s': %u words, expected %lu", prefix.c_str(), total, ranked.size());
+				return false;
+			}
+			for (size_t w = 0; w < completions.size(); w++) {
+				if (completions[w] != all[ranked[w]]) {
+					LOG_INFO("Prefix '%s' completion %lu: %s, expected %s", prefix.c_str(), w,
+						completions[w].c_str(), all[ranked[w]].c_str());
+					return false;
+				}
+			}
+		}
+	}
+
+	// listed weights win, everything else ranks alphabetically at 0
+	ofstream weights(TEST_WEIGHTS);
+	weights << "coined 7\nCOIN 9\nCOINZZ 100\n";
+	weights.close();
+	vector<string> completions;
+	if (!boggle.loadCompletions(RANK_WEIGHT, TEST_WEIGHTS) || (boggle.complete("COIN", 3, completions) == 0)
+		|| (completions.size() != 3) || (completions[0] != "COIN") || (completions[1] != "COINED")) {
+		return false;
+	}
+
+	for (uint32_t id = 0; id < wordCount; id++) {
+		if ((all[id].compare(0, 4, "COIN") == 0) && (all[id] != "COIN") && (all[id] != "COINED")) {
+			return completions[2] == all[id];
+		}
+	}
+
+	return false;
+}
+
+bool testPatternSearch(const char* dictFileName, const char* testTrieFileName) {
+	Boggle boggle(dictFileName, testTrieFileName, LAYOUT_DEFAULT | LAYOUT_LOUDS);
+	uint32_t wordCount = boggle.getTrieInfo().wordCount;
+	vector<string> all(wordCount);
+	for (uint32_t id = 0; id < wordCount; id++) {
+		boggle.getWord(id, all[id]);
+	}
+
+	// patterns against the same patterns as regular expressions
+	const char* patterns[][2] = {
+		{ "c?in*", "C[A-Z]IN[A-Z]*" },
+		{ "*[aeiou][aeiou][aeiou]*", "[A-Z]*[AEIOU][AEIOU][AEIOU][A-Z]*" },
+		{ "[^a-w]**z?", "[XYZ][A-Z]*Z[A-Z]" },
+		{ "QU?Z", "QU[A-Z]Z" }
+	};
+	for (int p = 0; p < 4; p++) {
+		std::regex expression(patterns[p][1]);
+		vector<uint32_t> expected, matched;
+		for (uint32_t id = 0; id < wordCount; id++) {
+			if (std::regex_match(all[id], expression)) { expected.push_back(id); }
+		}
+		bool ret = boggle.matchPattern(patterns[p][0], [&all, &matched](const string& word, uint32_t wordId) {
+			if (all[wordId] == word) { matched.push_back(wordId); }
+			return true;
+		});
+		LOG_INFO("Pattern '%s': %lu matches, expected %lu", patterns[p][0], matched.size(), expected.size());
+		if (!ret || (matched != expected) || expected.empty()) {
+			return false;
+		}
+	}
+	// streaming stops when the callback says so; malformed patterns are refused
+	vector<string> first;
+	boggle.matchPattern("*", [&first](const string& word, uint32_t) {
+		first.push_back(word);
+		return first.size() < 3;
+	});
+	if ((first.size() != 3) || (first[2] != all[2])
+		|| boggle.matchPattern("C[A-", [](const string&, uint32_t) { return true; })) {
+		return false;
+	}
+
+	// a blank finds the union of the words for every letter in its place
+	const string letters = "SERTAPLINGODUCEMBATHRISEN";
+	std::set<uint32_t> expected;
+	for (char c = 'A'; c <= 'Z'; c++) {
+		string board = letters;
+		board[12] = c;
+		SolveResult result;
+		boggle.setBoard(board.c_str());
+		boggle.solve(result, ENGINE_COMPACT);
+		expected.insert(result.wordIds.begin(), result.wordIds.end());
+	}
+	string board = letters;
+	board[12] = BLANK_CELL;
+	SolveResult reference;
+	boggle.setBoard(board.c_str());
+	boggle.solve(reference, ENGINE_BOARD);
+	if (vector<uint32_t>(expected.begin(), expected.end()) != reference.wordIds) {
+		return false;
+	}
+
+	// every engine agrees on two blanks, one of them a starting corner
+	board[0] = BLANK_CELL;
+	boggle.setBoard(board.c_str());
+	boggle.solve(reference, ENGINE_BOARD);
+	const SolveEngine engines[] = { ENGINE_ITERATIVE, ENGINE_COMPACT, ENGINE_LOUDS, ENGINE_DICT };
+	for (int e = 0; e < 4; e++) {
+		SolveResult result;
+		boggle.solve(result, engines[e]);
+		if (!compareResults(reference, result)) {
+			LOG_INFO("Blank board differs on engine %d", engines[e]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool testDiceFilter() {
+	// JINX passes the letter counts, but J and X are only on the same die
+	DiceSet standard;
+	const char* words[] = { "QUIZ", "QAT", "PIZZAZZ", "JINX", "ABCDEFGHIJKLMNOPRSTUVWXYZA" };
+	const DiceFit fits[] = { DICE_FIT, DICE_BARE_Q, DICE_LETTERS, DICE_LETTERS, DICE_TOO_LONG };
+	for (int w = 0; w < 5; w++) {
+		if (standard.fit(words[w]) != fits[w]) {
+			LOG_INFO("%s: fit %d, expected %d", words[w], standard.fit(words[w]), fits[w]);
+			return false;
+		}
+	}
+
+	// the same dice, reordered, key the same trie file
+	ofstream file(TEST_DICE);
+	for (int d = DICE_COUNT - 1; d >= 0; d--) {
+		string die = standard.getDie(d);
+		std::reverse(die.begin(), die.end());
+		file << die << "\n";
+	}
+	file.close();
+	DiceSet dice;
+	if (!dice.load(TEST_DICE) || (dice.getKey() != standard.getKey())) {
+		return false;
+	}
+	string trieFileName = dice.keyedFileName("BoggleWords.trie");
+	remove(trieFileName.c_str());
+
+	// the filtered dictionary finds the same words on boards rolled from those
+	// dice; the loaded copy rolls them in another order, so roll the standard one
+	bool ret = true;
+	for (int pass = 0; pass < 2; pass++) {
+		Boggle full, filtered(standard);
+		if (filtered.getTrieInfo().letterCount >= full.getTrieInfo().letterCount) {
+			ret = false;
+		}
+		for (unsigned int seed = 0; (seed < 20) && ret; seed++) {
+			SolveResult expected, result;
+			full.newGame(seed);
+			full.solve(expected);
+			filtered.newGame(seed);
+			filtered.solve(result);
+			ret = compareResults(expected, result);
+		}
+	}
+	remove(trieFileName.c_str());
+
+	return ret;
+}
+
+bool testQuCells(const char* dictFileName, const char* testTrieFileName) {
+	// a Q cell reads "QU": no U cells are needed, and a U cell after the Q is a second U
+	const char* boards[] = { "QIETSTEARNOLDAPMBCGHKWYXZ", "QUITSLOAMBERDNGCHKPVWXYZF" };
+	const char* present[][4] = { { "QUIT", "QUITE", "QUIET", "QUIETS" }, { "QUOIT", "QUOITS", NULL, NULL } };
+	const char* absent[] = { "QUITS", "QUIT" };
+	Boggle boggle(dictFileName, testTrieFileName, LAYOUT_DEFAULT | LAYOUT_LOUDS);
+	const SolveEngine engines[] = { ENGINE_ITERATIVE, ENGINE_COMPACT, ENGINE_LOUDS, ENGINE_DICT };
+
+	for (int b = 0; b < 2; b++) {
+		SolveResult reference;
+		boggle.setBoard(boards[b]);
+		boggle.solve(reference, ENGINE_BOARD);
+		for (int w = 0; (w < 4) && (present[b][w] != NULL); w++) {
+			if (std::find(reference.words.begin(), reference.words.end(), present[b][w]) == reference.words.end()) {
+				LOG_INFO("Board %s is missing %s", boards[b], present[b][w]);
+				return false;
+			}
+		}
+		if (std::find(reference.words.begin(), reference.words.end(), absent[b]) != reference.words.end()) {
+			LOG_INFO("Board %s has %s", boards[b], absent[b]);
+			return false;
+		}
+
+		for (int e = 0; e < 4; e++) {
+			SolveResult result;
+			boggle.solve(result, engines[e]);
+			if (!compareResults(reference, result)) {
+				LOG_INFO("Board %s differs on engine %d", boards[b], engines[e]);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool testWordIterator(const char* dictFileName, const char* testTrieFileName) {
+	Boggle boggle(dictFileName, testTrieFileName);
+	WordIterator iterator(boggle);
+
+	// run to the end, the iterator yields exactly the solve's words, once each
+	for (unsigned int seed = 0; seed < TEST_SEEDCOUNT; seed++) {
+		SolveResult result;
+		boggle.newGame(seed);
+		boggle.solve(result);
+		iterator.reset();
+
+		vector<uint32_t> wordIds;
+		uint32_t wordId;
+		int len;
+		while (iterator.next(wordId, len)) {
+			wordIds.push_back(wordId);
+		}
+		std::sort(wordIds.begin(), wordIds.end());
+		if ((wordIds != result.wordIds) || (iterator.getPoints() != result.points)) {
+			LOG_INFO("Seed %u: %lu words for %d points, expected %lu for %d", seed, wordIds.size(),
+				iterator.getPoints(), result.wordIds.size(), result.points);
+			return false;
+		}
+	}
+
+	// stopping early leaves the rest of the board unsearched, and reset starts over
+	boggle.newGame(7);
+	iterator.reset();
+	string word, first;
+	for (int w = 0; (w < 3) && iterator.next(word); w++) {
+		if (w == 0) { first = word; }
+	}
+	iterator.reset();
+	return (iterator.getWordCount() == 0) && iterator.next(word) && (word == first);
+}
+
+bool testSolveDeadline(const char* dictFileName, const char* testTrieFileName) {
+	Boggle boggle(dictFileName, testTrieFileName);
+	SolveMetrics before = Boggle::getMetrics();
+	std::atomic<bool> cancel(false);
+	int partial = 0;
+
+	for (unsigned int seed = 0; seed < TEST_SEEDCOUNT; seed++) {
+		SolveResult full, late, expired, cancelled;
+		boggle.newGame(seed);
+		boggle.solve(full, ENGINE_DICT);
+
+		// a deadline that never comes changes nothing but the engine
+		SolveOptions options;
+		options.engine = ENGINE_DICT;
+		options.deadline = std::chrono::steady_clock::now() + std::chrono::hours(1);
+		boggle.solve(late, options);
+		if (!late.complete || (late.engine == ENGINE_DICT) || (late.wordIds != full.wordIds) || (late.points != full.points)) {
+			LOG_INFO("Seed %u: far deadline solve differs", seed);
+			return false;
+		}
+
+		// past deadlines and set tokens stop at the first check with a subset
+		options.deadline = std::chrono::steady_clock::now();
+		boggle.solve(expired, options);
+		options.deadline = std::chrono::steady_clock::time_point::max();
+		options.cancel = &cancel;
+		cancel = true;
+		boggle.solve(cancelled, options);
+		cancel = false;
+		const SolveResult* stopped[] = { &expired, &cancelled };
+		for (int r = 0; r < 2; r++) {
+			if (!std::includes(full.wordIds.begin(), full.wordIds.end(),
+					stopped[r]->wordIds.begin(), stopped[r]->wordIds.end())) {
+				LOG_INFO("Seed %u: stopped solve found words the full solve did not", seed);
+				return false;
+			}
+			if (!stopped[r]->complete) { partial++; }
+		}
+	}
+
+	// tiny boards can finish inside the first check; most seeds must not
+	SolveMetrics after = Boggle::getMetrics();
+	uint64_t stoppedCount = (after.timeouts - before.timeouts) + (after.cancels - before.cancels);
+	return (partial > (int)TEST_SEEDCOUNT) && (stoppedCount == (uint64_t)partial)
+		&& (after.bounded - before.bounded == 3 * TEST_SEEDCOUNT);
+}
+
+// workers die on one board, every time
+class CrashingSupervisor : public Supervisor {
+	public:
+		CrashingSupervisor(Boggle& boggle, unsigned int workers) : Supervisor(boggle, workers) { }
+
+	protected:
+		void solveBoard(unsigned int seed, SolveResult& result, const SolveOptions& options) {
+			if (seed == TEST_CRASHSEED) {
+				kill(getpid(), SIGKILL);
+			}
+			Supervisor::solveBoard(seed, result, options);
+		}
+};
+
+bool testSupervisor(const char* dictFileName, const char* testTrieFileName) {
+	Boggle boggle(dictFileName, testTrieFileName);
+	std::ostringstream serial, pooled, crashed;
+
+	// in-process reference, one JSON line per board
+	{
+		ResultWriter writer(serial, FORMAT_JSON);
+		for (unsigned int seed = 0; seed < TEST_SEEDCOUNT; seed++) {
+			boggle.newGame(seed);
+			boggle.solveGame(writer);
+		}
+	}
+
+	{
+		// the caller's SIGPIPE handler survives the run
+		ResultWriter writer(pooled, FORMAT_JSON);
+		Supervisor supervisor(boggle, 3);
+		signal(SIGPIPE, SIG_DFL);
+		if (!supervisor.run(TEST_SEEDCOUNT, 0, writer) || (supervisor.getRestarts() != 0)
+				|| (signal(SIGPIPE, SIG_DFL) != SIG_DFL)) {
+			return false;
+		}
+	}
+	if (pooled.str() != serial.str()) {
+		LOG_INFO("Supervisor output differs from the in-process solve");
+		return false;
+	}
+
+	// a poison board is retried, then skipped; everything else still comes out in order
+	{
+		ResultWriter writer(crashed, FORMAT_JSON);
+		CrashingSupervisor supervisor(boggle, 3);
+		if (!supervisor.run(TEST_SEEDCOUNT, 0, writer)) {
+			return false;
+		}
+		if ((supervisor.getRestarts() != SUPERVISOR_RETRIES) || (supervisor.getSkipped() != 1)) {
+			LOG_INFO("%u restarts and %u skipped boards, expected %d and 1", supervisor.getRestarts(),
+				supervisor.getSkipped(), SUPERVISOR_RETRIES);
+			return false;
+		}
+	}
+	std::istringstream lines(serial.str());
+	string line, expected;
+	for (unsigned int seed = 0; getline(lines, line); seed++) {
+		if (seed != TEST_CRASHSEED) { expected += line + "\n"; }
+	}
+
+	return crashed.str() == expected;
+}
+
+bool testOverlayDicts(const char* dictFileName, const char* testTrieFileName) {
+	// a word leaves the trie with its last dictionary, and the others keep it
+	Trie trie;
+	trie.insert("ANTS", 4, DICT_BASE | 0x2);
+	trie.insert("ANTSY", 5, 0x2);
+	if (!trie.erase("ANTSY", 5, 0x2) || (trie.getDictionaries() != (DICT_BASE | 0x2)) || trie.erase("ANTSY", 5)
+			|| !trie.erase("ANTS", 4, 0x2) || (trie.getDictionaries() != DICT_BASE)) {
+		return false;
+	}
+
+	// overlay 2 is every other word of a board plus a word not in the dictionary
+	SolveResult full;
+	vector<string> selected;
+	{
+		Boggle boggle(dictFileName, testTrieFileName);
+		boggle.newGame(5);
+		boggle.solve(full);
+		ofstream file(TEST_OVERLAY);
+		for (size_t w = 0; w < full.words.size(); w += 2) {
+			file << full.words[w] << std::endl;
+			selected.push_back(full.words[w]);
+		}
+		file << "QZXJV" << std::endl;
+		file.close();
+		if (!boggle.loadOverlay(TEST_OVERLAY, 2)) {
+			return false;
+		}
+	}
+
+	// the selection survives the trie file, and the unselected list is pruned away
+	Boggle boggle(dictFileName, testTrieFileName);
+	boggle.newGame(5);
+	const uint8_t selections[] = { 0x4, DICT_BASE, DICTS_ALL };
+	for (int s = 0; s < 3; s++) {
+		SolveOptions options;
+		options.dictionaries = selections[s];
+		SolveResult result;
+		boggle.solve(result, options);
+		if (result.words != ((s == 0) ? selected : full.words)) {
+			LOG_INFO("Selection %02x found %lu words", selections[s], result.words.size());
+			return false;
+		}
+	}
+	uint32_t wordId;
+	return boggle.getWordId("QZXJV", wordId);
+}
+
+bool testScoreBound(const char* dictFileName, const char* testTrieFileName) {
+	// never below the exact score, on seeded boards and on Q and blank cells
+	Boggle boggle(dictFileName, testTrieFileName);
+	const char* boards[] = { "QIETSTEARNOLDAPMBCGHKWYXZ", "SERTAPLIN?ODUCEMBATHRISEN", "??EST?ARNOLDQPMBCGHKWYX?Z" };
+	SolveOptions options;
+	options.listWords = false;
+	SolveResult result;
+	uint64_t points = 0, bounds = 0;
+
+	for (unsigned int b = 0; b < TEST_SEEDCOUNT + 3; b++) {
+		if (b < TEST_SEEDCOUNT) {
+			boggle.newGame(b);
+		} else {
+			boggle.setBoard(boards[b - TEST_SEEDCOUNT]);
+		}
+		char letters[BOARD_CELLS + 1];
+		boggle.getBoard(letters);
+		boggle.solve(result, options);
+		int bound = boggle.scoreBound();
+		if (bound < result.points) {
+			LOG_INFO("Board %s scores %d, bound %d", letters, result.points, bound);
+			return false;
+		}
+		if (b < TEST_SEEDCOUNT) {
+			points += result.points;
+			bounds += bound;
+		}
+	}
+	LOG_INFO("Score bound is %.2f times the score on seeded boards", (double)bounds / points);
+
+	return true;
+}
+
+bool testWordPaths(const char* dictFileName, const char* testTrieFileName) {
+	// every path spells its word along distinct adjacent cells, and keeping
+	// them changes nothing else about the result
+	Boggle boggle(dictFileName, testTrieFileName);
+	const char* boards[] = { "QIETSTEARNOLDAPMBCGHKWYXZ", "SERTAPLIN?ODUCEMBATHRISEN" };
+	SolveResult plain, first, all;
+	SolveOptions options;
+
+	for (unsigned int b = 0; b < TEST_SEEDCOUNT + 2; b++) {
+		if (b < TEST_SEEDCOUNT) {
+			boggle.newGame(b);
+		} else {
+			boggle.setBoard(boards[b - TEST_SEEDCOUNT]);
+		}
+		char letters[BOARD_CELLS + 1];
+		boggle.getBoard(letters);
+		options.paths = PATHS_NONE;
+		boggle.solve(plain, options);
+		options.paths = PATHS_FIRST;
+		boggle.solve(first, options);
+		options.paths = PATHS_ALL;
+		boggle.solve(all, options);
+
+		if (!plain.paths.empty() || (first.wordIds != plain.wordIds) || (all.wordIds != plain.wordIds) ||
+				(first.points != plain.points) || (first.paths.size() != first.wordIds.size()) ||
+				(all.paths.size() < first.paths.size())) {
+			LOG_INFO("Board %s: %lu words, %lu first paths, %lu paths", letters, plain.wordIds.size(),
+				first.paths.size(), all.paths.size());
+			return false;
+		}
+
+		size_t word = 0;
+		for (size_t p = 0; p < all.paths.size(); p++) {
+			const WordPath& path = all.paths[p];
+			while ((word < all.wordIds.size()) && (all.wordIds[word] != path.wordId)) {
+				word++;
+			}
+			if ((word == all.wordIds.size()) || (first.paths[word].wordId != path.wordId)) {
+				LOG_INFO("Board %s: path to word %u out of order", letters, path.wordId);
+				return false;
+			}
+
+			// spell the path, a blank cell taking the word's letter
+			const string& text = all.words[word];
+			size_t at = 0;
+			uint32_t cells = 0;
+			for (uint32_t step = 0; step < path.length; step++) {
+				int cell = path.getCell(step);
+				int prev = (step > 0) ? path.getCell(step - 1) : cell;
+				bool adjacent = (abs(cell / BOARD_SIZE - prev / BOARD_SIZE) <= 1) &&
+					(abs(cell % BOARD_SIZE - prev % BOARD_SIZE) <= 1);
+				bool spelled = (at < text.length()) && ((letters[cell] == BLANK_CELL) || (letters[cell] == text[at]));
+				at += ((letters[cell] == 'Q') || ((letters[cell] == BLANK_CELL) && (text[at] == 'Q'))) ? 2 : 1;
+				if ((cell >= BOARD_CELLS) || (cells & (1u << cell)) || !adjacent || !spelled) {
+					LOG_INFO("Board %s: path %lu doesn't spell %s", letters, p, text.c_str());
+					return false;
+				}
+				cells |= 1u << cell;
+			}
+			if (at != text.length()) {
+				LOG_INFO("Board %s: path %lu is short of %s", letters, p, text.c_str());
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool testCApi(const char* dictFileName, const char* testTrieFileName) {
+	// loaded and mapped handles match Boggle::solve, from several threads at
+	// once and when the word array runs out mid-batch
+	Boggle boggle(dictFileName, testTrieFileName);
+	string boards;
+	vector<int32_t> scores;
+	vector<uint32_t> wordIds;
+	vector<uint64_t> offsets(1, 0);
+	char letters[BOARD_CELLS + 1];
+	SolveResult result;
+
+	for (unsigned int seed = 0; seed < TEST_SEEDCOUNT; seed++) {
+		boggle.newGame(seed);
+		boggle.getBoard(letters);
+		boggle.solve(result);
+		boards.append(letters, BOARD_CELLS);
+		scores.push_back(result.points);
+		wordIds.insert(wordIds.end(), result.wordIds.begin(), result.wordIds.end());
+		offsets.push_back(wordIds.size());
+	}
+	boards.append("abcdefghijklmnopqrstuvwxy");
+	scores.push_back(-1);
+	offsets.push_back(wordIds.size());
+	size_t count = scores.size();
+	if (!boggle.saveCompact(TEST_COMPACT)) {
+		return false;
+	}
+
+	// the library keeps to its own log file, off the console
+	boggle_log(TEST_APILOG);
+	boggle_dict* dicts[] = { boggle_open(dictFileName, testTrieFileName), boggle_open(NULL, TEST_COMPACT) };
+	bool same = (dicts[0] != NULL) && (dicts[1] != NULL) && (boggle_open(NULL, dictFileName) == NULL);
+	if (same && ((boggle_solve(NULL, boards.data(), count, &scores[0], NULL, 0, NULL) != BOGGLE_ERROR_ARGUMENT) ||
+			(boggle_solve(dicts[0], boards.data(), count, &scores[0], &wordIds[0], 0, NULL) != BOGGLE_ERROR_ARGUMENT))) {
+		LOG_INFO("boggle_solve() accepted a NULL argument");
+		same = false;
+	}
+
+	// a truncated file, a child index past the end and a word ID past the word count
+	std::ifstream compactFile(TEST_COMPACT, std::ios::binary);
+	string compact((std::istreambuf_iterator<char>(compactFile)), std::istreambuf_iterator<char>());
+	for (int c = 0; (c < 3) && same; c++) {
+		string corrupt = compact;
+		if (c == 0) {
+			corrupt.resize(corrupt.size() / 2);
+		} else if (c == 1) {
+			uint32_t firstChild = 0xfffffff0u;
+			std::memcpy(&corrupt[sizeof(CompactTrieHeader) + offsetof(CompactTrieNode, firstChild)], &firstChild,
+				sizeof(firstChild));
+		} else {
+			uint32_t wordCount = 1;
+			std::memcpy(&corrupt[offsetof(CompactTrieHeader, wordCount)], &wordCount, sizeof(wordCount));
+		}
+		std::ofstream corruptFile(TEST_CORRUPT, std::ios::binary | std::ios::trunc);
+		corruptFile.write(corrupt.data(), corrupt.size());
+		corruptFile.close();
+		boggle_dict* corruptDict = boggle_open(NULL, TEST_CORRUPT);
+		if (corruptDict != NULL) {
+			LOG_INFO("Corrupt compact trie %d opened", c);
+			boggle_close(corruptDict);
+			same = false;
+		}
+	}
+	for (int d = 0; (d < 2) && same; d++) {
+		std::atomic<bool> match(true);
+		vector<std::thread> threads;
+		for (int t = 0; t < 4; t++) {
+			threads.push_back(std::thread([&boards, &scores, &wordIds, &offsets, &dicts, &match, count, d]() {
+				vector<int32_t> threadScores(count);
+				vector<uint32_t> threadIds(wordIds.size());
+				vector<uint64_t> threadOffsets(count + 1);
+				int64_t solved = boggle_solve(dicts[d], boards.data(), count, threadScores.data(), threadIds.data(),
+					threadIds.size(), threadOffsets.data());
+				if ((solved != (int64_t)count) || (threadScores != scores) || (threadIds != wordIds) || (threadOffsets != offsets)) {
+					match = false;
+				}
+			}));
+		}
+		for (size_t t = 0; t < threads.size(); t++) {
+			threads[t].join();
+		}
+
+		// a few boards' worth of room at a time, resuming where each call stopped
+		vector<int32_t> chunkScores(count);
+		vector<uint32_t> chunkIds(1000), allIds;
+		vector<uint64_t> chunkOffsets(count + 1);
+		for (size_t done = 0; done < count; ) {
+			int64_t solved = boggle_solve(dicts[d], &boards[done * BOARD_CELLS], count - done, &chunkScores[done],
+				chunkIds.data(), chunkIds.size(), chunkOffsets.data());
+			if (solved <= 0) {
+				match = false;
+				break;
+			}
+			allIds.insert(allIds.end(), chunkIds.begin(), chunkIds.begin() + chunkOffsets[solved]);
+			done += solved;
+		}
+		same = match && (chunkScores == scores) && (allIds == wordIds);
+	}
+	boggle_close(dicts[0]);
+	boggle_close(dicts[1]);
+	boggle_log(NULL);
+
+	std::ifstream apiLog(TEST_APILOG);
+	string logged((std::istreambuf_iterator<char>(apiLog)), std::istreambuf_iterator<char>());
+	if (logged.empty()) {
+		LOG_INFO("The library didn't log to '%s'", TEST_APILOG);
+		same = false;
+	}
+
+	// back on the unit test's own log and console
+	Logger::Instance()->openLogFile(TEST_LOG, false);
+	Logger::Instance()->setConsole(stdout, stderr);
+
+	return same;
+}
+
+bool testDefaultDictionary(const char* dictFileName, const char* testTrieFileName) {
+	// the default constructor, which in EMBEDDED_DICT builds runs on the linked
+	// compact trie alone, agrees with a file-loaded solver on every engine
+	Boggle reference(dictFileName, testTrieFileName);
+	Boggle boggle;
+	SolveEngine engines[] = { ENGINE_AUTO, ENGINE_BOARD, ENGINE_DICT, ENGINE_ITERATIVE, ENGINE_COMPACT, ENGINE_LOUDS };
+	SolveResult expected, result;
+
+	for (unsigned int seed = 0; seed < TEST_SEEDCOUNT; seed++) {
+		reference.newGame(seed);
+		reference.solve(expected);
+		boggle.newGame(seed);
+		for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+			boggle.solve(result, engines[e]);
+			if ((result.points != expected.points) || (result.wordIds != expected.wordIds)) {
+				LOG_INFO("Seed %u engine %d: %d points, expected %d", seed, (int)engines[e], result.points,
+					expected.points);
+				return false;
+			}
+		}
+
+		// bounded solves order their starting cells by the prefix counts
+		SolveOptions options;
+		options.deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		boggle.solve(result, options);
+		if (!result.complete || (result.points != expected.points)) {
+			LOG_INFO("Seed %u bounded: %d points, expected %d", seed, result.points, expected.points);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool testConsoleOutput(const char* dictFileName, const char* testTrieFileName) {
+	// with results on stdout, as BoggleMain writes them without --output, log
+	// lines go to stderr and stdout parses as nothing but records
+	const unsigned int games = 20;
+	std::cout.flush();
+	fflush(stdout);
+	int savedStdout = dup(STDOUT_FILENO);
+	int captured = open(TEST_STDOUT, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if ((savedStdout < 0) || (captured < 0)) {
+		LOG_INFO("Unable to capture stdout in '%s'", TEST_STDOUT);
+		return false;
+	}
+	dup2(captured, STDOUT_FILENO);
+	close(captured);
+	Logger::Instance()->setConsole(stderr, stderr);
+
+	size_t dictWords;
+	{
+		Boggle boggle(dictFileName, testTrieFileName);
+		dictWords = boggle.getTrieInfo().wordCount;
+		OutputFormat formats[] = { FORMAT_JSON, FORMAT_BINARY };
+		for (int f = 0; f < 2; f++) {
+			ResultWriter writer(std::cout, formats[f]);
+			for (unsigned int seed = 0; seed < games; seed++) {
+				boggle.newGame(seed);
+				boggle.solveGame(writer);
+				LOG_INFO("Solved game %u", seed);
+			}
+		}
+	}
+
+	std::cout.flush();
+	fflush(stdout);
+	dup2(savedStdout, STDOUT_FILENO);
+	close(savedStdout);
+	Logger::Instance()->setConsole(stdout, stderr);
+
+	ifstream in(TEST_STDOUT, std::ios::in | std::ios::binary);
+	std::stringstream contents;
+	contents << in.rdbuf();
+	string out = contents.str();
+
+	// JSON: one object per line, braces and brackets balanced outside strings
+	size_t at = 0;
+	for (unsigned int game = 0; game < games; game++) {
+		size_t end = out.find('\n', at);
+		if ((end == string::npos) || (out.compare(at, 10, "{\"board\":\"") != 0)) {
+			LOG_INFO("JSON line %u doesn't start a record", game);
+			return false;
+		}
+		int depth = 0;
+		bool quoted = false;
+		for (size_t i = at; i < end; i++) {
+			char c = out[i];
+			if (c == '"') { quoted = !quoted; }
+			else if (quoted) { continue; }
+			else if ((c == '{') || (c == '[')) { depth++; }
+			else if ((c == '}') || (c == ']')) { depth--; }
+			if ((depth == 0) && (i + 1 < end)) {
+				LOG_INFO("JSON line %u has text after its object", game);
+				return false;
+			}
+		}
+		if ((depth != 0) || quoted) {
+			LOG_INFO("JSON line %u is unbalanced", game);
+			return false;
+		}
+		at = end + 1;
+	}
+
+	// binary: records back to back up to the end of the stream
+	for (unsigned int game = 0; game < games; game++) {
+		uint32_t points, wordCount;
+		if (at + BOARD_CELLS + 2 * sizeof(uint32_t) > out.size()) {
+			LOG_INFO("Binary record %u is truncated", game);
+			return false;
+		}
+		for (int cell = 0; cell < BOARD_CELLS; cell++) {
+			char c = out[at + cell];
+			if (((c < 'A') || (c > 'Z')) && (c != BLANK_CELL)) {
+				LOG_INFO("Binary record %u has a bad board", game);
+				return false;
+			}
+		}
+		at += BOARD_CELLS;
+		memcpy(&points, &out[at], sizeof(points));
+		memcpy(&wordCount, &out[at + sizeof(points)], sizeof(wordCount));
+		at += 2 * sizeof(uint32_t);
+		if ((wordCount > dictWords) || (at + wordCount * sizeof(uint32_t) > out.size())) {
+			LOG_INFO("Binary record %u has %u words", game, wordCount);
+			return false;
+		}
+		for (uint32_t w = 0; w < wordCount; w++) {
+			uint32_t wordId;
+			memcpy(&wordId, &out[at + w * sizeof(uint32_t)], sizeof(wordId));
+			if (wordId >= dictWords) {
+				LOG_INFO("Binary record %u has word ID %u", game, wordId);
+				return false;
+			}
+		}
+		at += wordCount * sizeof(uint32_t);
+	}
+
+	if (at != out.size()) {
+		LOG_INFO("%lu bytes of stdout after the records", out.size() - at);
+		return false;
+	}
+
+	return true;
+}
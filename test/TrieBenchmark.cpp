@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_set>
+#include <vector>
+
+#include "Logger.h"
+#include "Trie.h"
+
+#define DICTFILE "BoggleWords.dict"
+#define BENCH_LOG "TrieBenchmark.log"
+#define BENCH_CSV "TrieBenchmark.csv"
+#define BENCH_TRIEFILE "TrieBenchmark.trie"
+#define BENCH_SCALE 10u			// synthetic dictionary size, in multiples of the real one
+#define BENCH_REPEATS 3			// runs per measurement, the fastest is reported
+#define BENCH_SEED 1u
+
+using std::chrono::steady_clock;
+using std::vector;
+
+/*
+ * Per-operation timings of the pointer Trie, as CSV rows
+ *
+ *     dict,words,op,items,ms,ns_per_item,mb_per_s
+ *
+ * dict is "real" or "synthetic", words the dictionary's word count, items
+ * what op touched (words or nodes), and mb_per_s the trie file throughput
+ * for serialize and deserialize, empty otherwise. Rows and columns only
+ * ever get added at the end.
+ */
+struct BenchRow {
+	const char* dict;
+	size_t words;
+	const char* op;
+	uint64_t items;
+	double ms;
+	double mbPerS;	// negative when not a throughput
+};
+
+// helper functions
+double elapsedMs(steady_clock::time_point start);
+bool loadWords(const char* fileName, vector<string>& words);
+void synthesizeWords(const vector<string>& words, unsigned int scale, vector<string>& synthetic);
+bool lookupWord(Trie& trie, const string& word);
+uint64_t fileBytes(const char* fileName);
+void writeRow(FILE* csv, const BenchRow& row);
+
+// benchmarks
+void benchTrie(const char* dict, const vector<string>& words, FILE* csv);
+
+int main(int argc, char** argv) {
+	unsigned int scale = BENCH_SCALE;
+	const char* csvFileName = BENCH_CSV;
+	if (argc > 1) {
+		scale = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		csvFileName = argv[2];
+	}
+
+	Logger::Instance()->openLogFile(BENCH_LOG, true);
+	FILE* csv = fopen(csvFileName, "w");
+	if (csv == NULL) {
+		LOG_ERROR("Unable to open '%s'.", csvFileName);
+		return 1;
+	}
+	fprintf(csv, "dict,words,op,items,ms,ns_per_item,mb_per_s\n");
+
+	vector<string> words;
+	if (!loadWords(DICTFILE, words)) {
+		fclose(csv);
+		return 1;
+	}
+	LOG_INFO("Benchmarking trie operations on '%s', %lu words", DICTFILE, words.size());
+	benchTrie("real", words, csv);
+
+	if (scale > 1) {
+		vector<string> synthetic;
+		synthesizeWords(words, scale, synthetic);
+		words.clear();
+		words.shrink_to_fit();
+		LOG_INFO("Benchmarking trie operations on a synthetic dictionary, %lu words", synthetic.size());
+		benchTrie("synthetic", synthetic, csv);
+	}
+
+	remove(BENCH_TRIEFILE);
+	fclose(csv);
+	LOG_INFO("Results in '%s'", csvFileName);
+	Logger::Instance()->closeLogFile();
+}
+
+/***********
+ * Helpers *
+ ***********/
+
+double elapsedMs(steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+bool loadWords(const char* fileName, vector<string>& words) {
+	ifstream file(fileName);
+	if (!file.is_open()) {
+		LOG_ERROR("Unable to open dictionary file '%s'.", fileName);
+		return false;
+	}
+
+	string word;
+	while (getline(file, word)) {
+		if (!word.empty() && (word[word.length() - 1] == '\r')) {
+			word.erase(word.length() - 1);
+		}
+		if (!word.empty()) {
+			words.push_back(word);
+		}
+	}
+
+	return true;
+}
+
+void synthesizeWords(const vector<string>& words, unsigned int scale, vector<string>& synthetic) {
+	// Real words plus copies with one letter changed in their back half, so the
+	// new words share the real prefixes, as inflections and compounds do
+	std::mt19937 rng(BENCH_SEED);
+	std::unordered_set<string> seen(words.begin(), words.end());
+	synthetic = words;
+	size_t target = words.size() * scale;
+	while (synthetic.size() < target) {
+		string word = words[rng() % words.size()];
+		size_t position = word.length() / 2 + rng() % (word.length() - word.length() / 2);
+		int letter = rng() % 26;
+		word[position] = indexToChar(letter);
+		if (seen.insert(word).second) {
+			synthetic.push_back(word);
+		}
+	}
+	std::sort(synthetic.begin(), synthetic.end());
+}
+
+bool lookupWord(Trie& trie, const string& word) {
+	TrieNode* node = trie.getRoot();
+	for (size_t i = 0; (i < word.length()) && (node != NULL); i++) {
+		node = node->children[charToIndex(word[i])];
+	}
+
+	return (node != NULL) && node->isLeaf;
+}
+
+uint64_t fileBytes(const char* fileName) {
+	struct stat info;
+	return (stat(fileName, &info) == 0) ? info.st_size : 0;
+}
+
+void writeRow(FILE* csv, const BenchRow& row) {
+	double nsPerItem = (row.items > 0) ? row.ms * 1e6 / row.items : 0.0;
+	if (row.mbPerS >= 0.0) {
+		fprintf(csv, "%s,%lu,%s,%" PRIu64 ",%.3f,%.2f,%.1f\n", row.dict, row.words, row.op, row.items, row.ms,
+			nsPerItem, row.mbPerS);
+		LOG_INFO("dict=%s op=%s items=%" PRIu64 " ms=%.3f ns_per_item=%.2f mb_per_s=%.1f", row.dict, row.op,
+			row.items, row.ms, nsPerItem, row.mbPerS);
+	} else {
+		fprintf(csv, "%s,%lu,%s,%" PRIu64 ",%.3f,%.2f,\n", row.dict, row.words, row.op, row.items, row.ms, nsPerItem);
+		LOG_INFO("dict=%s op=%s items=%" PRIu64 " ms=%.3f ns_per_item=%.2f", row.dict, row.op, row.items, row.ms,
+			nsPerItem);
+	}
+	fflush(csv);
+}
+
+/**************
+ * Benchmarks *
+ **************/
+
+void benchTrie(const char* dict, const vector<string>& words, FILE* csv) {
+	BenchRow row = { dict, words.size(), "", 0, 0.0, -1.0 };
+	double insertMs = 0.0, destroyMs = 0.0;
+	uint64_t nodes = 0;
+
+	// insert in dictionary order, then tear down; fastest of the repeats
+	for (int r = 0; r < BENCH_REPEATS; r++) {
+		Trie* trie = new Trie();
+		steady_clock::time_point start = steady_clock::now();
+		for (size_t w = 0; w < words.size(); w++) {
+			trie->insert(words[w].c_str(), words[w].length());
+		}
+		double ms = elapsedMs(start);
+		insertMs = (r == 0) ? ms : std::min(insertMs, ms);
+		nodes = trie->getTrieInfo().letterCount + 1;
+
+		start = steady_clock::now();
+		delete trie;
+		ms = elapsedMs(start);
+		destroyMs = (r == 0) ? ms : std::min(destroyMs, ms);
+	}
+	row.op = "insert";
+	row.items = words.size();
+	row.ms = insertMs;
+	writeRow(csv, row);
+
+	Trie trie;
+	for (size_t w = 0; w < words.size(); w++) {
+		trie.insert(words[w].c_str(), words[w].length());
+	}
+
+	// hits in dictionary order and shuffled, and misses: each word with a letter appended
+	vector<const string*> shuffled(words.size());
+	for (size_t w = 0; w < words.size(); w++) {
+		shuffled[w] = &words[w];
+	}
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(BENCH_SEED));
+	const char* lookupOps[] = { "lookup_sequential", "lookup_random", "lookup_miss" };
+	for (int op = 0; op < 3; op++) {
+		double best = 0.0;
+		size_t hits = 0;
+		string miss;
+		for (int r = 0; r < BENCH_REPEATS; r++) {
+			hits = 0;
+			steady_clock::time_point start = steady_clock::now();
+			for (size_t w = 0; w < words.size(); w++) {
+				if (op == 0) {
+					hits += lookupWord(trie, words[w]);
+				} else if (op == 1) {
+					hits += lookupWord(trie, *shuffled[w]);
+				} else {
+					miss.assign(*shuffled[w]).push_back('Q');
+					hits += lookupWord(trie, miss);
+				}
+			}
+			double ms = elapsedMs(start);
+			best = (r == 0) ? ms : std::min(best, ms);
+		}
+		if ((op < 2) && (hits != words.size())) {
+			LOG_ERROR("%s found %lu of %lu words", lookupOps[op], hits, words.size());
+		}
+		row.op = lookupOps[op];
+		row.items = words.size();
+		row.ms = best;
+		writeRow(csv, row);
+	}
+
+	double infoMs = 0.0;
+	for (int r = 0; r < BENCH_REPEATS; r++) {
+		steady_clock::time_point start = steady_clock::now();
+		TrieInfo info = trie.getTrieInfo();
+		double ms = elapsedMs(start);
+		infoMs = (r == 0) ? ms : std::min(infoMs, ms);
+		nodes = info.letterCount + 1;
+	}
+	row.op = "get_trie_info";
+	row.items = nodes;
+	row.ms = infoMs;
+	writeRow(csv, row);
+
+	// file throughput, over the bytes of the trie file
+	double serializeMs = 0.0, deserializeMs = 0.0, compareMs = 0.0;
+	bool same = true;
+	for (int r = 0; r < BENCH_REPEATS; r++) {
+		remove(BENCH_TRIEFILE);
+		steady_clock::time_point start = steady_clock::now();
+		trie.serialize(BENCH_TRIEFILE);
+		double ms = elapsedMs(start);
+		serializeMs = (r == 0) ? ms : std::min(serializeMs, ms);
+
+		Trie* loaded = new Trie();
+		start = steady_clock::now();
+		loaded->deserialize(BENCH_TRIEFILE);
+		ms = elapsedMs(start);
+		deserializeMs = (r == 0) ? ms : std::min(deserializeMs, ms);
+
+		start = steady_clock::now();
+		same = trie.trieCompare(*loaded) && same;
+		ms = elapsedMs(start);
+		compareMs = (r == 0) ? ms : std::min(compareMs, ms);
+		delete loaded;
+	}
+	if (!same) {
+		LOG_ERROR("Deserialized trie differs from the original");
+	}
+	double megabytes = fileBytes(BENCH_TRIEFILE) / 1e6;
+	row.op = "serialize";
+	row.items = nodes;
+	row.ms = serializeMs;
+	row.mbPerS = megabytes * 1000.0 / serializeMs;
+	writeRow(csv, row);
+	row.op = "deserialize";
+	row.ms = deserializeMs;
+	row.mbPerS = megabytes * 1000.0 / deserializeMs;
+	writeRow(csv, row);
+	row.mbPerS = -1.0;
+
+	row.op = "trie_compare";
+	row.items = nodes;
+	row.ms = compareMs;
+	writeRow(csv, row);
+
+	// the bottom-up hash pass deserialize and trie_compare pay after an edit
+	double rehashMs = 0.0;
+	for (int r = 0; r < BENCH_REPEATS; r++) {
+		steady_clock::time_point start = steady_clock::now();
+		trie.rehash();
+		double ms = elapsedMs(start);
+		rehashMs = (r == 0) ? ms : std::min(rehashMs, ms);
+	}
+	row.op = "rehash";
+	row.items = nodes;
+	row.ms = rehashMs;
+	writeRow(csv, row);
+
+	row.op = "destroy";
+	row.items = nodes;
+	row.ms = destroyMs;
+	writeRow(csv, row);
+}